@@ -0,0 +1,190 @@
+/* Asynchronous direct I/O file input for MARLIN SDR */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include "transmitter.h"
+
+// Reads kept in flight
+static int aio_depth = DEFAULT_AIO_DEPTH;
+
+// Sets the number of reads kept in flight. Exits if it is out of range.
+void set_aio_depth(int depth) {
+    if(depth < 1 || depth > MAX_AIO_DEPTH) {
+        printf("error: aio queue depth must be between 1 and %d\n", MAX_AIO_DEPTH);
+        exit(0);
+    }
+    aio_depth = depth;
+}
+
+// Submits a read of the next block of the file into a block buffer. Sets the error flag if it cannot be submitted.
+static void submit_block(struct aio_input *in, struct aio_block *block) {
+    struct iocb *iocbs[1] = { &block->iocb };
+
+    io_prep_pread(&block->iocb, in->fd, block->data, AIO_BLOCK_BYTES, in->submit_offset);
+    block->done = false;
+    block->failed = false;
+    block->num_bytes = 0;
+    block->window.offset = in->submit_offset;
+    if(io_submit(in->ctx, 1, iocbs) != 1) {
+        printf("\nerror: could not submit read at offset %lld\n", (long long)in->submit_offset);
+        in->error = true;
+        return;
+    }
+    in->submit_offset += AIO_BLOCK_BYTES;
+    in->queue[(in->head + in->in_flight) % in->depth] = block - in->blocks;
+    in->in_flight++;
+}
+
+// Waits until the oldest block has been read. Reads finish in any order, the others are marked done.
+// A failed read is marked done and failed, the error flag is set once the reader gets to it.
+static void wait_for_head(struct aio_input *in) {
+    struct aio_block *head = &in->blocks[in->queue[in->head]];
+    struct io_event events[MAX_AIO_DEPTH];
+    struct aio_block *block;
+    int num_events;
+
+    while(!head->done) {
+        num_events = io_getevents(in->ctx, 1, MAX_AIO_DEPTH, events, NULL);
+        if(num_events == -EINTR) {
+            continue;
+        }
+        less_than_zero_error_check(num_events, "io_getevents");
+        for(int n = 0; n < num_events; n++) {
+            block = (struct aio_block *)((char *)events[n].obj - offsetof(struct aio_block, iocb));
+            if((long)events[n].res < 0) {
+                printf("\nerror: read failed (%s)\n", strerror(-(long)events[n].res));
+                block->failed = true;
+            } else {
+                block->num_bytes = events[n].res;
+            }
+            block->done = true;
+        }
+    }
+}
+
+// Opens fp for asynchronous reads and starts reading the first depth blocks. Falls back to reads through
+// the page cache if the file system does not support direct I/O.
+void open_aio_input(struct aio_input *in, FILE *fp, off_t file_size) {
+    char fd_path[32];
+
+    memset(in, 0, sizeof(*in));
+    in->depth = aio_depth;
+    in->file_size = file_size;
+
+    // Open the file a second time so that the stdio file is left as it is
+    snprintf(fd_path, sizeof(fd_path), "/proc/self/fd/%d", fileno(fp));
+    in->fd = open(fd_path, O_RDONLY | O_DIRECT);
+    if(in->fd < 0) {
+        printf("Direct I/O is not supported for this file, reading through the page cache\n");
+        in->fd = open(fd_path, O_RDONLY);
+        less_than_zero_error_check(in->fd, "input fd");
+    }
+    if(io_setup(in->depth, &in->ctx) < 0) {
+        printf("error: could not set up asynchronous I/O\n");
+        exit(0);
+    }
+    for(int n = 0; n < in->depth; n++) {
+        if(posix_memalign((void **)&in->blocks[n].data, AIO_ALIGN, AIO_BLOCK_BYTES) != 0) {
+            printf("error: could not allocate aio block\n");
+            exit(0);
+        }
+        in->blocks[n].window.base = in->blocks[n].data;
+        in->blocks[n].window.length = AIO_BLOCK_BYTES;
+        in->blocks[n].window.aio_block = true;
+        if(in->submit_offset < in->file_size && !in->error) {
+            submit_block(in, &in->blocks[n]);
+        }
+    }
+}
+
+// Submits the used up blocks that no packet holds anymore for the next unread parts of the file
+static void submit_released_blocks(struct aio_input *in) {
+    for(int n = 0; n < in->depth; n++) {
+        if(in->blocks[n].used && __atomic_load_n(&in->blocks[n].window.refs, __ATOMIC_ACQUIRE) == 0) {
+            in->blocks[n].used = false;
+            if(in->submit_offset < in->file_size && !in->error) {
+                submit_block(in, &in->blocks[n]);
+            }
+        }
+    }
+}
+
+// Marks num_bytes of the oldest block as used. A used up block leaves the queue and is read into again once
+// the packets holding it have released it. A block that came up short before the end of the file sets the
+// error flag.
+static void use_head_bytes(struct aio_input *in, size_t num_bytes) {
+    struct aio_block *head = &in->blocks[in->queue[in->head]];
+
+    in->head_pos += num_bytes;
+    if(in->head_pos == head->num_bytes) {
+        if(head->window.offset + (off_t)head->num_bytes < in->file_size && head->num_bytes < AIO_BLOCK_BYTES) {
+            printf("\nerror: short read before the end of the file\n");
+            in->error = true;
+        }
+        head->used = true;
+        in->in_flight--;
+        in->head_pos = 0;
+        in->head = (in->head + 1) % in->depth;
+        submit_released_blocks(in);
+    }
+}
+
+// Reads up to max_bytes of the file, fewer only at the end of the file. Data within one block is not copied:
+// data is set to point into the block and window to the block's window, which has to be released once the data
+// is no longer needed. Data running over into the next block is copied into buffer, and window is set to NULL.
+// A block is only handed out while another one is in flight (or it holds the end of the file), so there is
+// always a block to read on with and the reader never waits for packets to release one.
+// Returns the number of bytes read. Once the error flag is set, the data read before the error is returned
+// and nothing after it.
+size_t read_aio_input(struct aio_input *in, unsigned char *buffer, size_t max_bytes,
+                      const unsigned char **data, struct input_window **window) {
+    struct aio_block *head;
+    size_t num_bytes = 0, copy_bytes;
+    bool last_block;
+
+    *data = buffer;
+    *window = NULL;
+    submit_released_blocks(in);
+    while(num_bytes < max_bytes && in->in_flight > 0 && !in->error) {
+        wait_for_head(in);
+        head = &in->blocks[in->queue[in->head]];
+        if(head->failed) {
+            in->error = true;
+            break;
+        }
+        copy_bytes = head->num_bytes - in->head_pos;
+        last_block = head->window.offset + (off_t)head->num_bytes >= in->file_size;
+        if(num_bytes == 0 && (copy_bytes >= max_bytes || last_block) && (in->in_flight > 1 || last_block)) {
+            num_bytes = copy_bytes < max_bytes ? copy_bytes : max_bytes;
+            *data = head->data + in->head_pos;
+            *window = &head->window;
+            __atomic_add_fetch(&head->window.refs, 1, __ATOMIC_RELAXED);
+            use_head_bytes(in, num_bytes);
+            break;
+        }
+        if(copy_bytes > max_bytes - num_bytes) {
+            copy_bytes = max_bytes - num_bytes;
+        }
+        memcpy(buffer + num_bytes, head->data + in->head_pos, copy_bytes);
+        num_bytes += copy_bytes;
+        use_head_bytes(in, copy_bytes);
+    }
+    return num_bytes;
+}
+
+// Waits for reads still in flight and closes the direct I/O file
+void close_aio_input(struct aio_input *in) {
+    while(in->in_flight > 0) {
+        wait_for_head(in);
+        in->in_flight--;
+        in->head = (in->head + 1) % in->depth;
+    }
+    io_destroy(in->ctx);
+    for(int n = 0; n < in->depth; n++) {
+        free(in->blocks[n].data);
+    }
+    close(in->fd);
+}
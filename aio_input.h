@@ -0,0 +1,52 @@
+#ifndef AIO_INPUT_H
+#define AIO_INPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <libaio.h>
+#include "mapped_input.h"
+
+// Asynchronous input configuration. Reads bypass the page cache (O_DIRECT), so buffers, offsets and
+// lengths are aligned to the largest logical block size of the storage devices the ADALM-PLUTO reads.
+#define AIO_BLOCK_BYTES (1024 * 1024)   // Bytes per read
+#define AIO_ALIGN 4096
+#define DEFAULT_AIO_DEPTH 4             // Reads kept in flight
+#define MAX_AIO_DEPTH 64
+
+// A block of the file being read. Its data is handed to the modulator through its window, like a mapped window.
+struct aio_block {
+    struct iocb iocb;
+    unsigned char *data;
+    size_t num_bytes;           // Bytes read, once done
+    bool done;
+    bool failed;                // Done, but the read failed
+    struct input_window window; // Held by the packets pointing into the block
+    bool used;                  // Used up, waiting for the packets holding it to release it
+};
+
+// A file read with a queue of asynchronous reads. Blocks are submitted in file order, and each one is
+// submitted again for the next unread part of the file once it has been used up and no packet holds it.
+struct aio_input {
+    int fd;
+    io_context_t ctx;
+    int depth;
+    struct aio_block blocks[MAX_AIO_DEPTH];
+    int queue[MAX_AIO_DEPTH];   // Blocks submitted but not used up, a ring in file order
+    off_t file_size;
+    off_t submit_offset;        // File offset of the next block to submit
+    int in_flight;              // Blocks in the queue
+    int head;                   // Queue position of the oldest block, the one being used
+    size_t head_pos;            // Bytes of the oldest block already used
+    bool error;                 // A read failed or came up short, nothing more is read
+};
+
+// Function prototypes
+void set_aio_depth(int depth);
+void open_aio_input(struct aio_input *in, FILE *fp, off_t file_size);
+size_t read_aio_input(struct aio_input *in, unsigned char *buffer, size_t max_bytes,
+                      const unsigned char **data, struct input_window **window);
+void close_aio_input(struct aio_input *in);
+
+#endif /* AIO_INPUT_H */
@@ -0,0 +1,223 @@
+/* Microbenchmarks of the per byte transmit kernels for MARLIN SDR */
+
+#include <time.h>
+#include "transmitter.h"
+
+// Data and samples shared by the benchmarks
+static unsigned char *data;
+static uint32_t *samples;
+static unsigned char *coded;
+static int8_t *soft;
+static unsigned char *decoded;
+static unsigned char *received;     // Reed-Solomon codewords with errors, copied for each decoder run
+static uint32_t *tx_copy;           // Stands in for the transmit buffer the pipeline pusher copies frames into
+static enum code_rate rate;         // Code rate of the encoder and decoder kernels
+static volatile uint32_t sink;      // Keeps results alive so the benchmarked work is not optimized out
+
+// Returns a monotonic time in seconds
+static double benchmark_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Runs a kernel over the benchmark data until BENCHMARK_MIN_SECONDS have passed.
+// Returns the time per byte in nanoseconds.
+static double time_kernel(void (*kernel)(const struct constellation *c), const struct constellation *c) {
+    double start, elapsed;
+    long runs = 0;
+
+    kernel(c);      // Warm up the caches and tables
+    start = benchmark_seconds();
+    do {
+        kernel(c);
+        runs++;
+        elapsed = benchmark_seconds() - start;
+    } while(elapsed < BENCHMARK_MIN_SECONDS);
+    return elapsed * 1e9 / ((double)runs * BENCHMARK_BYTES);
+}
+
+// Kernels
+static void crc32_kernel(const struct constellation *c) {
+    (void)c;
+    sink = crc32_update(0, data, BENCHMARK_BYTES);
+}
+
+static void crc32_bytewise_kernel(const struct constellation *c) {
+    (void)c;
+    sink = crc32_update_bytewise(0, data, BENCHMARK_BYTES);
+}
+
+static void modulation_kernel(const struct constellation *c) {
+    sink = map_bytes(c, data, BENCHMARK_BYTES, samples);
+}
+
+static void buffer_copy_kernel(const struct constellation *c) {
+    size_t num_samples = BENCHMARK_BYTES * 8 / c->bits_per_symbol, buffer_samples = get_buffer_samples(), n;
+    for(size_t pos = 0; pos < num_samples; pos += n) {
+        n = num_samples - pos < buffer_samples ? num_samples - pos : buffer_samples;
+        memcpy(tx_copy, samples + pos, n * sizeof(uint32_t));
+    }
+    sink = tx_copy[0];
+}
+
+static void encode_kernel(const struct constellation *c) {
+    struct conv_encoder enc;
+    (void)c;
+    start_conv_encoder(&enc, rate, coded);
+    conv_encode(&enc, data, BENCHMARK_BYTES);
+    sink = finish_conv_encoder(&enc);
+}
+
+static void decode_kernel(const struct constellation *c) {
+    (void)c;
+    viterbi_decode(rate, soft, BENCHMARK_BYTES, decoded);
+    sink = decoded[0];
+}
+
+static void rs_encode_kernel(const struct constellation *c) {
+    struct rs_encoder enc;
+    (void)c;
+    start_rs_encoder(&enc, coded);
+    rs_encode(&enc, data, BENCHMARK_BYTES);
+    sink = finish_rs_encoder(&enc);
+}
+
+static void rs_decode_kernel(const struct constellation *c) {
+    (void)c;
+    sink = rs_decode(coded, BENCHMARK_BYTES, decoded);
+}
+
+static void rs_correct_kernel(const struct constellation *c) {
+    (void)c;
+    memcpy(coded, received, rs_coded_bytes(BENCHMARK_BYTES));
+    sink = rs_decode(coded, BENCHMARK_BYTES, decoded);
+}
+
+// Prints the time per byte and throughput of a kernel, without ending the line
+static void print_result(const char *name, double ns_per_byte) {
+    printf("  %-20s %7.3f ns/byte %9.1f MB/s", name, ns_per_byte, 1e3 / ns_per_byte);
+}
+
+// Times the convolutional encoder and Viterbi decoder of a code rate. The decoder gets the coded bits of the
+// benchmark data without noise.
+static void benchmark_code_rate() {
+    size_t num_bits = conv_coded_bits(rate, BENCHMARK_BYTES);
+    char name[32];
+    double ns;
+
+    snprintf(name, sizeof(name), "Encode rate %s", code_rate_name(rate));
+    ns = time_kernel(encode_kernel, NULL);
+    print_result(name, ns);
+    printf("   %6.1f Mbit/s, %6.1f Mbit/s coded\n", 8e3 / ns, 8e3 / ns * num_bits / (8.0 * BENCHMARK_BYTES));
+
+    for(size_t bit = 0; bit < num_bits; bit++) {
+        soft[bit] = ((coded[bit / 8] >> (7 - bit % 8)) & 1) ? -BENCHMARK_SOFT : BENCHMARK_SOFT;
+    }
+    snprintf(name, sizeof(name), "Decode rate %s", code_rate_name(rate));
+    ns = time_kernel(decode_kernel, NULL);
+    print_result(name, ns);
+    printf("   %6.1f Mbit/s%s\n", 8e3 / ns, memcmp(decoded, data, BENCHMARK_BYTES) == 0 ? "" : ", DECODING ERRORS");
+}
+
+// Times the copy of QPSK frames into transmit buffers that the pipeline pusher makes, which the event loop
+// avoids by framing straight into the buffer, against the QPSK modulation of the same data
+static void benchmark_buffer_copy(double qpsk_ns) {
+    double ns;
+
+    map_bytes(get_constellation(MOD_QPSK), data, BENCHMARK_BYTES, samples);
+    ns = time_kernel(buffer_copy_kernel, get_constellation(MOD_QPSK));
+    print_result("QPSK buffer copy", ns);
+    printf("   %5.1f%% of QPSK modulation\n", 100.0 * ns / qpsk_ns);
+}
+
+// Times the Reed-Solomon RS(255,223) encoder against QPSK modulation, which it runs in front of, and the decoder
+// on codewords without errors and with BENCHMARK_RS_ERRORS byte errors each
+static void benchmark_reed_solomon(double qpsk_ns) {
+    size_t saved_block_bytes = get_rs_block_bytes(), num_coded_bytes;
+    uint32_t state = 1;
+    double ns;
+    int num_corrected;
+
+    set_rs_block_bytes(RS_SYMBOLS);
+    num_coded_bytes = rs_coded_bytes(BENCHMARK_BYTES);
+    ns = time_kernel(rs_encode_kernel, NULL);
+    print_result("Encode RS(255,223)", ns);
+    printf("   %6.1f Mbit/s, %5.1f%% of QPSK modulation\n", 8e3 / ns, 100.0 * ns / qpsk_ns);
+
+    ns = time_kernel(rs_decode_kernel, NULL);
+    print_result("Decode RS(255,223)", ns);
+    printf("   %6.1f Mbit/s without errors%s\n", 8e3 / ns,
+           memcmp(decoded, data, BENCHMARK_BYTES) == 0 ? "" : ", DECODING ERRORS");
+
+    memcpy(received, coded, num_coded_bytes);
+    for(size_t start = 0; start < num_coded_bytes; start += RS_SYMBOLS) {
+        size_t num_bytes = num_coded_bytes - start < RS_SYMBOLS ? num_coded_bytes - start : RS_SYMBOLS;
+        for(int e = 0; e < BENCHMARK_RS_ERRORS; e++) {
+            received[start + next_pseudo_random(&state) % num_bytes] ^= 0x5A;
+        }
+    }
+    ns = time_kernel(rs_correct_kernel, NULL);
+    num_corrected = rs_decode(coded, BENCHMARK_BYTES, decoded);
+    print_result("Correct RS(255,223)", ns);
+    printf("   %6.1f Mbit/s with %d errors per codeword%s\n", 8e3 / ns, BENCHMARK_RS_ERRORS,
+           num_corrected >= 0 && memcmp(decoded, data, BENCHMARK_BYTES) == 0 ? "" : ", DECODING ERRORS");
+    set_rs_block_bytes(saved_block_bytes);
+}
+
+// Times the CRC-32 against the modulation of every constellation, showing what share of the per byte cost of
+// each one it adds, then the copy into transmit buffers, the encoder and decoder of every code rate and the
+// Reed-Solomon code. Needs the constellations, CRC and forward error correction tables to be set up.
+void run_benchmarks() {
+    const size_t max_samples = BENCHMARK_BYTES * 8;     // BPSK, 1 bit per sample
+    const size_t max_coded_bits = BENCHMARK_BYTES * 16 + 2 * CONV_TAIL_BITS;
+    double crc_ns, qpsk_ns = 0, ns;
+    uint32_t state = 1;
+
+    data = malloc(BENCHMARK_BYTES);
+    null_error_check((void *)data, "benchmark data");
+    samples = malloc(max_samples * sizeof(uint32_t));
+    null_error_check((void *)samples, "benchmark samples");
+    coded = malloc(max_coded_bits / 8 + 1);
+    null_error_check((void *)coded, "benchmark coded");
+    soft = malloc(max_coded_bits);
+    null_error_check((void *)soft, "benchmark soft");
+    decoded = malloc(BENCHMARK_BYTES);
+    null_error_check((void *)decoded, "benchmark decoded");
+    received = malloc(max_coded_bits / 8 + 1);
+    null_error_check((void *)received, "benchmark received");
+    tx_copy = malloc(get_buffer_samples() * sizeof(uint32_t));
+    null_error_check((void *)tx_copy, "benchmark transmit buffer");
+    fill_pseudo_random(data, BENCHMARK_BYTES, &state);
+
+    printf("Benchmarking %d kB of data per run\n", BENCHMARK_BYTES / 1024);
+    crc_ns = time_kernel(crc32_kernel, NULL);
+    print_result("CRC-32 slice-by-8", crc_ns);
+    printf("\n");
+    print_result("CRC-32 bytewise", time_kernel(crc32_bytewise_kernel, NULL));
+    printf("\n");
+    for(int id = 0; id < NUM_MODULATIONS; id++) {
+        const struct constellation *c = get_constellation(id);
+        char name[32];
+        ns = time_kernel(modulation_kernel, c);
+        snprintf(name, sizeof(name), "%s modulation", c->name);
+        print_result(name, ns);
+        printf("   CRC-32 is %5.1f%% of it\n", 100.0 * crc_ns / ns);
+        if(id == MOD_QPSK) {
+            qpsk_ns = ns;
+        }
+    }
+    benchmark_buffer_copy(qpsk_ns);
+    for(rate = CODE_RATE_1_2; rate < NUM_CODE_RATES; rate++) {
+        benchmark_code_rate();
+    }
+    benchmark_reed_solomon(qpsk_ns);
+
+    free(data);
+    free(samples);
+    free(coded);
+    free(soft);
+    free(decoded);
+    free(received);
+    free(tx_copy);
+}
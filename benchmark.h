@@ -0,0 +1,13 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Benchmark configuration
+#define BENCHMARK_BYTES (256 * 1024)        // Data processed per run, about one frame and held in the L2 cache
+#define BENCHMARK_MIN_SECONDS 0.5           // Each kernel is run for at least this long
+#define BENCHMARK_SOFT 64                   // Soft value of the coded bits given to the decoder
+#define BENCHMARK_RS_ERRORS 8               // Byte errors per codeword given to the Reed-Solomon decoder
+
+// Function prototypes
+void run_benchmarks();
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,390 @@
+/* Convolutional forward error correction for MARLIN SDR */
+
+#include "transmitter.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CONV_VERIFY_BYTES 100           // Longest frame checked by verify_convolutional_code
+#define CONV_VERIFY_SOFT 100            // Soft value of the coded bits fed back to the decoder when verifying
+#define VITERBI_START_METRIC 2048       // Path metric of the states the encoder cannot start in
+
+// Puncturing patterns of each code rate, the X and Y bits kept at each position of the pattern
+static const int puncture_period[NUM_CODE_RATES] = { 1, 1, 2, 3, 7 };
+static const char *puncture_x[NUM_CODE_RATES] = { "1", "1", "10", "101", "1000101" };
+static const char *puncture_y[NUM_CODE_RATES] = { "1", "1", "11", "110", "1111010" };
+static const char *rate_names[NUM_CODE_RATES] = { "none", "1/2", "2/3", "3/4", "7/8" };
+
+// Code rate of the frames, set with set_code_rate
+static enum code_rate code_rate = CODE_RATE_NONE;
+
+// Coded bits of 4 input bits from each state (X and Y of each bit, the first input bit in the high bits), and
+// the kept bits and their number at each nibble position of the puncturing pattern of each rate
+static uint8_t encode_table[CONV_STATES * 16];
+static uint8_t puncture_table[NUM_CODE_RATES][MAX_PUNCTURE_PHASES][256];
+static int puncture_count[NUM_CODE_RATES][MAX_PUNCTURE_PHASES];
+static int puncture_phases[NUM_CODE_RATES];
+
+// Signs of the branch metrics of the butterflies, from the X and Y bits of old state i (0 to 31) with input 0
+static bool branch_x[CONV_STATES / 2];
+static bool branch_y[CONV_STATES / 2];
+
+// Returns the X and Y bits of a 7 bit shift register, the newest bit in bit 0
+static int conv_output(int shift_register) {
+    return __builtin_parity(shift_register & CONV_POLY_X) << 1 | __builtin_parity(shift_register & CONV_POLY_Y);
+}
+
+// Returns true if the X (y is false) or Y (y is true) bit of an input bit at position of the pattern is sent
+static bool is_kept(enum code_rate rate, size_t position, bool y) {
+    const char *pattern = y ? puncture_y[rate] : puncture_x[rate];
+    return pattern[position % puncture_period[rate]] == '1';
+}
+
+// Builds the encoder, puncturing and butterfly tables
+void set_up_convolutional_code() {
+    for(int state = 0; state < CONV_STATES; state++) {
+        for(int nibble = 0; nibble < 16; nibble++) {
+            int shift_register = state, coded = 0;
+            for(int bit = 3; bit >= 0; bit--) {
+                shift_register = (shift_register << 1) | ((nibble >> bit) & 1);
+                coded = (coded << 2) | conv_output(shift_register);
+            }
+            encode_table[state << 4 | nibble] = (uint8_t)coded;
+        }
+    }
+
+    for(int rate = CODE_RATE_1_2; rate < NUM_CODE_RATES; rate++) {
+        int period = puncture_period[rate];
+        puncture_phases[rate] = 1;
+        while(puncture_phases[rate] * 4 % period != 0) {
+            puncture_phases[rate]++;
+        }
+        for(int phase = 0; phase < puncture_phases[rate]; phase++) {
+            for(int coded = 0; coded < 256; coded++) {
+                int kept = 0, count = 0;
+                for(int bit = 0; bit < 8; bit++) {
+                    if(is_kept(rate, phase * 4 + bit / 2, bit % 2 == 1)) {
+                        kept = (kept << 1) | ((coded >> (7 - bit)) & 1);
+                        count++;
+                    }
+                }
+                puncture_table[rate][phase][coded] = (uint8_t)kept;
+                puncture_count[rate][phase] = count;
+            }
+        }
+    }
+
+    for(int state = 0; state < CONV_STATES / 2; state++) {
+        int output = conv_output(state << 1);
+        branch_x[state] = (output >> 1) & 1;
+        branch_y[state] = output & 1;
+    }
+}
+
+// Sets the code rate of the frames by name, exits if there is no such rate
+void set_code_rate(const char *name) {
+    for(int rate = 0; rate < NUM_CODE_RATES; rate++) {
+        if(strcmp(name, rate_names[rate]) == 0) {
+            code_rate = rate;
+            return;
+        }
+    }
+    printf("error: unknown code rate %s, use none, 1/2, 2/3, 3/4 or 7/8\n", name);
+    exit(0);
+}
+
+// Returns the code rate of the frames
+enum code_rate get_code_rate() {
+    return code_rate;
+}
+
+// Returns the name of a code rate
+const char *code_rate_name(enum code_rate rate) {
+    return rate_names[rate];
+}
+
+// Returns the number of coded bits of a frame with num_data_bytes, including the tail bits
+size_t conv_coded_bits(enum code_rate rate, size_t num_data_bytes) {
+    size_t num_input_bits = num_data_bytes * 8 + CONV_TAIL_BITS;
+    size_t period = puncture_period[rate], per_period = 0, num_bits;
+
+    if(rate == CODE_RATE_NONE) {
+        return num_data_bytes * 8;
+    }
+    for(size_t position = 0; position < period; position++) {
+        per_period += is_kept(rate, position, false) + is_kept(rate, position, true);
+    }
+    num_bits = num_input_bits / period * per_period;
+    for(size_t position = 0; position < num_input_bits % period; position++) {
+        num_bits += is_kept(rate, position, false) + is_kept(rate, position, true);
+    }
+    return num_bits;
+}
+
+// Returns the number of coded bytes of a frame with num_data_bytes, the last one padded with 0 bits
+size_t conv_coded_bytes(enum code_rate rate, size_t num_data_bytes) {
+    return (conv_coded_bits(rate, num_data_bytes) + 7) / 8;
+}
+
+// Returns the most data bytes whose coded bytes fit in num_coded_bytes
+size_t conv_data_bytes(enum code_rate rate, size_t num_coded_bytes) {
+    size_t num_data_bytes = num_coded_bytes;
+
+    if(rate == CODE_RATE_NONE) {
+        return num_coded_bytes;
+    }
+    while(num_data_bytes > 0 && conv_coded_bytes(rate, num_data_bytes) > num_coded_bytes) {
+        // Jump most of the way with the rate, then step to the exact number
+        size_t estimate = num_data_bytes * num_coded_bytes / conv_coded_bytes(rate, num_data_bytes);
+        num_data_bytes = estimate < num_data_bytes ? estimate : num_data_bytes - 1;
+    }
+    while(conv_coded_bytes(rate, num_data_bytes + 1) <= num_coded_bytes) {
+        num_data_bytes++;
+    }
+    return num_data_bytes;
+}
+
+// Starts encoding a frame into coded, which holds conv_coded_bytes of the frame
+void start_conv_encoder(struct conv_encoder *enc, enum code_rate rate, unsigned char *coded) {
+    enc->rate = rate;
+    enc->state = 0;
+    enc->phase = 0;
+    enc->num_input_bits = 0;
+    enc->bits = 0;
+    enc->num_bits = 0;
+    enc->coded = coded;
+    enc->coded_start = coded;
+}
+
+// Adds up to 8 coded bits to the coded bytes
+static inline void put_coded_bits(struct conv_encoder *enc, uint32_t bits, int num_bits) {
+    enc->bits = (enc->bits << num_bits) | bits;
+    enc->num_bits += num_bits;
+    if(enc->num_bits >= 8) {
+        enc->num_bits -= 8;
+        *enc->coded++ = (unsigned char)(enc->bits >> enc->num_bits);
+    }
+}
+
+// Encodes 4 input bits with one table lookup and punctures them with another
+static inline void encode_nibble(struct conv_encoder *enc, int nibble) {
+    uint8_t coded = encode_table[enc->state << 4 | nibble];
+    enc->state = ((enc->state << 4) | nibble) & (CONV_STATES - 1);
+    put_coded_bits(enc, puncture_table[enc->rate][enc->phase][coded], puncture_count[enc->rate][enc->phase]);
+    if(++enc->phase == puncture_phases[enc->rate]) {
+        enc->phase = 0;
+    }
+    enc->num_input_bits += 4;
+}
+
+// Encodes one input bit, used for the tail bits
+static void encode_bit(struct conv_encoder *enc, int bit) {
+    int shift_register = (enc->state << 1) | bit;
+    int output = conv_output(shift_register);
+
+    enc->state = shift_register & (CONV_STATES - 1);
+    if(is_kept(enc->rate, enc->num_input_bits, false)) {
+        put_coded_bits(enc, (output >> 1) & 1, 1);
+    }
+    if(is_kept(enc->rate, enc->num_input_bits, true)) {
+        put_coded_bits(enc, output & 1, 1);
+    }
+    enc->num_input_bits++;
+}
+
+// Encodes more data of the frame
+void conv_encode(struct conv_encoder *enc, const unsigned char *data, size_t num_bytes) {
+    for(size_t n = 0; n < num_bytes; n++) {
+        encode_nibble(enc, data[n] >> 4);
+        encode_nibble(enc, data[n] & 0xF);
+    }
+}
+
+// Ends the frame with the tail bits, which bring the encoder back to state 0, and pads the last coded byte.
+// Returns the number of coded bytes.
+size_t finish_conv_encoder(struct conv_encoder *enc) {
+    for(int bit = 0; bit < CONV_TAIL_BITS; bit++) {
+        encode_bit(enc, 0);
+    }
+    if(enc->num_bits > 0) {
+        *enc->coded++ = (unsigned char)(enc->bits << (8 - enc->num_bits));
+        enc->num_bits = 0;
+    }
+    return enc->coded - enc->coded_start;
+}
+
+// Returns the soft value of the X (y is false) or Y (y is true) bit of an input bit at position of the pattern,
+// 0 for a punctured bit
+static inline int next_soft(enum code_rate rate, int position, bool y, const int8_t **soft) {
+    const char *pattern = y ? puncture_y[rate] : puncture_x[rate];
+    return pattern[position] == '1' ? *(*soft)++ : 0;
+}
+
+// Runs the add-compare-select of every input bit one state at a time, writing the decisions of each bit.
+// Used on hosts without SSE2 and as the reference when verifying the SSE2 kernel.
+static void viterbi_forward_reference(enum code_rate rate, const int8_t *soft, size_t num_input_bits, uint64_t *decisions) {
+    const size_t period = puncture_period[rate];
+    int metrics[CONV_STATES], new_metrics[CONV_STATES];
+
+    for(int state = 0; state < CONV_STATES; state++) {
+        metrics[state] = state == 0 ? 0 : VITERBI_START_METRIC;
+    }
+    for(size_t t = 0, position = 0; t < num_input_bits; t++, position = position + 1 == period ? 0 : position + 1) {
+        int soft_x = next_soft(rate, position, false, &soft);
+        int soft_y = next_soft(rate, position, true, &soft);
+        uint64_t decision = 0;
+
+        // Butterflies: old states i and i + 32 go to new states 2i (input 0) and 2i + 1 (input 1)
+        for(int i = 0; i < CONV_STATES / 2; i++) {
+            int branch = (branch_x[i] ? soft_x : -soft_x) + (branch_y[i] ? soft_y : -soft_y);
+            int from_low = metrics[i] + branch, from_high = metrics[i + CONV_STATES / 2] - branch;
+            new_metrics[2 * i] = from_low > from_high ? from_high : from_low;
+            decision |= (uint64_t)(from_low > from_high) << (2 * i);
+            from_low = metrics[i] - branch;
+            from_high = metrics[i + CONV_STATES / 2] + branch;
+            new_metrics[2 * i + 1] = from_low > from_high ? from_high : from_low;
+            decision |= (uint64_t)(from_low > from_high) << (2 * i + 1);
+        }
+        for(int state = 0; state < CONV_STATES; state++) {
+            metrics[state] = new_metrics[state] - new_metrics[0];      // Keeps the metrics small
+        }
+        decisions[t] = decision;
+    }
+}
+
+#ifdef __SSE2__
+// SSE2 kernel of the add-compare-select, 8 states per instruction with 16-bit path metrics. The 32 low and
+// 32 high old states are 4 vectors each, and the new even and odd states they go to are interleaved with
+// unpack, so the butterflies need no other shuffles. The metrics stay within a few thousand of state 0.
+static void viterbi_forward_sse2(enum code_rate rate, const int8_t *soft, size_t num_input_bits, uint64_t *decisions) {
+    const size_t period = puncture_period[rate];
+    __m128i metrics[8], x_mask[4], y_mask[4];
+
+    for(int n = 0; n < 4; n++) {
+        int16_t x[8], y[8];
+        for(int lane = 0; lane < 8; lane++) {
+            x[lane] = branch_x[8 * n + lane] ? 0 : -1;     // Negates the soft value where the expected bit is 0
+            y[lane] = branch_y[8 * n + lane] ? 0 : -1;
+        }
+        x_mask[n] = _mm_loadu_si128((const __m128i *)x);
+        y_mask[n] = _mm_loadu_si128((const __m128i *)y);
+    }
+    metrics[0] = _mm_insert_epi16(_mm_set1_epi16(VITERBI_START_METRIC), 0, 0);
+    for(int n = 1; n < 8; n++) {
+        metrics[n] = _mm_set1_epi16(VITERBI_START_METRIC);
+    }
+
+    for(size_t t = 0, position = 0; t < num_input_bits; t++, position = position + 1 == period ? 0 : position + 1) {
+        __m128i soft_x = _mm_set1_epi16((int16_t)next_soft(rate, position, false, &soft));
+        __m128i soft_y = _mm_set1_epi16((int16_t)next_soft(rate, position, true, &soft));
+        __m128i new_metrics[8], base;
+        uint64_t decision = 0;
+
+        for(int n = 0; n < 4; n++) {
+            __m128i branch = _mm_add_epi16(_mm_sub_epi16(_mm_xor_si128(soft_x, x_mask[n]), x_mask[n]),
+                                           _mm_sub_epi16(_mm_xor_si128(soft_y, y_mask[n]), y_mask[n]));
+            __m128i even_low = _mm_adds_epi16(metrics[n], branch), even_high = _mm_subs_epi16(metrics[n + 4], branch);
+            __m128i odd_low = _mm_subs_epi16(metrics[n], branch), odd_high = _mm_adds_epi16(metrics[n + 4], branch);
+            __m128i even = _mm_min_epi16(even_low, even_high), odd = _mm_min_epi16(odd_low, odd_high);
+            __m128i even_decision = _mm_cmpgt_epi16(even_low, even_high), odd_decision = _mm_cmpgt_epi16(odd_low, odd_high);
+
+            new_metrics[2 * n] = _mm_unpacklo_epi16(even, odd);
+            new_metrics[2 * n + 1] = _mm_unpackhi_epi16(even, odd);
+            decision |= (uint64_t)_mm_movemask_epi8(_mm_packs_epi16(_mm_unpacklo_epi16(even_decision, odd_decision),
+                                                                    _mm_unpackhi_epi16(even_decision, odd_decision))) << (16 * n);
+        }
+        base = _mm_shufflelo_epi16(new_metrics[0], 0);
+        base = _mm_unpacklo_epi64(base, base);
+        for(int n = 0; n < 8; n++) {
+            metrics[n] = _mm_sub_epi16(new_metrics[n], base);       // Keeps the metrics small
+        }
+        decisions[t] = decision;
+    }
+}
+#endif
+
+// Traces the decisions back from state 0, where the tail bits leave the encoder, and writes the data bits
+static void viterbi_traceback(const uint64_t *decisions, size_t num_input_bits, size_t num_data_bytes, unsigned char *data) {
+    int state = 0;
+
+    memset(data, 0, num_data_bytes);
+    for(size_t t = num_input_bits; t-- > 0;) {
+        if(t < num_data_bytes * 8) {
+            data[t / 8] |= (state & 1) << (7 - t % 8);
+        }
+        state = (state >> 1) | (int)((decisions[t] >> state) & 1) << (CONV_CONSTRAINT_LENGTH - 2);
+    }
+}
+
+// Decodes a frame of num_data_bytes with or without the SSE2 kernel
+static void decode(enum code_rate rate, const int8_t *soft, size_t num_data_bytes, unsigned char *data, bool sse2) {
+    size_t num_input_bits = num_data_bytes * 8 + CONV_TAIL_BITS;
+    uint64_t *decisions = malloc(num_input_bits * sizeof(uint64_t));
+
+    null_error_check((void *)decisions, "viterbi decisions");
+#ifdef __SSE2__
+    if(sse2) {
+        viterbi_forward_sse2(rate, soft, num_input_bits, decisions);
+    } else
+#endif
+    {
+        (void)sse2;
+        viterbi_forward_reference(rate, soft, num_input_bits, decisions);
+    }
+    viterbi_traceback(decisions, num_input_bits, num_data_bytes, data);
+    free(decisions);
+}
+
+// Soft decision Viterbi decoder for host side decoding. soft holds one value per coded bit that was sent
+// (conv_coded_bits of the frame, without the padding of the last byte), positive for a 0 bit and negative for
+// a 1 bit, larger for more confidence. Punctured bits are decoded as erasures. Writes num_data_bytes of data.
+void viterbi_decode(enum code_rate rate, const int8_t *soft, size_t num_data_bytes, unsigned char *data) {
+    decode(rate, soft, num_data_bytes, data, true);
+}
+
+// Checks the table-driven encoder against encoding one bit at a time, and that the decoders (SSE2 and scalar)
+// recover frames of pseudo-random data of several lengths at every rate, at rate 1/2 also with bit errors.
+// Returns 0 if all of them match.
+int verify_convolutional_code() {
+    unsigned char data[CONV_VERIFY_BYTES], coded[2 * CONV_VERIFY_BYTES + 2], reference[2 * CONV_VERIFY_BYTES + 2];
+    unsigned char decoded[CONV_VERIFY_BYTES], decoded_reference[CONV_VERIFY_BYTES];
+    int8_t soft[16 * CONV_VERIFY_BYTES + 2 * CONV_TAIL_BITS];
+    static const size_t lengths[] = { 0, 1, 5, 33, CONV_VERIFY_BYTES };
+    struct conv_encoder enc;
+    uint32_t state = 1;
+
+    fill_pseudo_random(data, CONV_VERIFY_BYTES, &state);
+    for(int rate = CODE_RATE_1_2; rate < NUM_CODE_RATES; rate++) {
+        for(size_t length = 0; length < sizeof(lengths) / sizeof(lengths[0]); length++) {
+            size_t num_bytes = lengths[length], num_coded_bytes, num_bits = conv_coded_bits(rate, lengths[length]);
+
+            start_conv_encoder(&enc, rate, coded);
+            conv_encode(&enc, data, num_bytes);
+            num_coded_bytes = finish_conv_encoder(&enc);
+            start_conv_encoder(&enc, rate, reference);
+            for(size_t bit = 0; bit < num_bytes * 8; bit++) {
+                encode_bit(&enc, (data[bit / 8] >> (7 - bit % 8)) & 1);
+            }
+            if(num_coded_bytes != conv_coded_bytes(rate, num_bytes) || finish_conv_encoder(&enc) != num_coded_bytes ||
+               memcmp(coded, reference, num_coded_bytes) != 0) {
+                return -1;
+            }
+
+            for(size_t bit = 0; bit < num_bits; bit++) {
+                soft[bit] = ((coded[bit / 8] >> (7 - bit % 8)) & 1) ? -CONV_VERIFY_SOFT : CONV_VERIFY_SOFT;
+            }
+            if(rate == CODE_RATE_1_2 && num_bytes == CONV_VERIFY_BYTES) {
+                soft[10] = -soft[10];       // Errors far enough apart for the code to correct
+                soft[200] = -soft[200];
+                soft[601] = -soft[601];
+            }
+            decode(rate, soft, num_bytes, decoded, true);
+            decode(rate, soft, num_bytes, decoded_reference, false);
+            if(memcmp(decoded, data, num_bytes) != 0 || memcmp(decoded_reference, data, num_bytes) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
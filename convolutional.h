@@ -0,0 +1,56 @@
+#ifndef CONVOLUTIONAL_H
+#define CONVOLUTIONAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Convolutional code configuration. The K = 7 code with generator polynomials 171 and 133 (octal) used by
+// CCSDS, DVB-S and 802.11, punctured to the higher rates with the DVB-S patterns. Each frame is coded on its
+// own and ends with K - 1 zero tail bits, so the decoder starts and ends every frame in state 0.
+#define CONV_CONSTRAINT_LENGTH 7
+#define CONV_STATES (1 << (CONV_CONSTRAINT_LENGTH - 1))
+#define CONV_TAIL_BITS (CONV_CONSTRAINT_LENGTH - 1)
+#define CONV_POLY_X 0x4F                // 171 octal with the newest bit in bit 0
+#define CONV_POLY_Y 0x6D                // 133 octal with the newest bit in bit 0
+#define MAX_PUNCTURE_PERIOD 7
+#define MAX_PUNCTURE_PHASES 7           // Positions of a nibble of input bits in the puncturing pattern
+
+// Code rates, sent in the frame header flags
+enum code_rate {
+    CODE_RATE_NONE,
+    CODE_RATE_1_2,
+    CODE_RATE_2_3,
+    CODE_RATE_3_4,
+    CODE_RATE_7_8,
+    NUM_CODE_RATES
+};
+
+// Encodes a stream of bytes, most significant bit first. The coded bits of each input bit are its X bit and
+// then its Y bit, leaving out the bits punctured at its position in the pattern.
+struct conv_encoder {
+    enum code_rate rate;
+    int state;                  // Last 6 input bits, the newest in bit 0
+    int phase;                  // Nibble position in the puncturing pattern
+    size_t num_input_bits;
+    uint32_t bits;              // Coded bits not yet written
+    int num_bits;
+    unsigned char *coded;       // Next coded byte
+    unsigned char *coded_start;
+};
+
+// Function prototypes
+void set_up_convolutional_code();
+int verify_convolutional_code();
+void set_code_rate(const char *name);
+enum code_rate get_code_rate();
+const char *code_rate_name(enum code_rate rate);
+size_t conv_coded_bits(enum code_rate rate, size_t num_data_bytes);
+size_t conv_coded_bytes(enum code_rate rate, size_t num_data_bytes);
+size_t conv_data_bytes(enum code_rate rate, size_t num_coded_bytes);
+void start_conv_encoder(struct conv_encoder *enc, enum code_rate rate, unsigned char *coded);
+void conv_encode(struct conv_encoder *enc, const unsigned char *data, size_t num_bytes);
+size_t finish_conv_encoder(struct conv_encoder *enc);
+void viterbi_decode(enum code_rate rate, const int8_t *soft, size_t num_data_bytes, unsigned char *data);
+
+#endif /* CONVOLUTIONAL_H */
@@ -0,0 +1,91 @@
+/* Table-driven CRC-32 for MARLIN SDR */
+
+#include "transmitter.h"
+
+// crc_table[0] is the usual table of the CRC of each byte. crc_table[n] holds the CRC of each byte followed by
+// n zero bytes, so the 8 bytes of a step are looked up independently and combined with XOR.
+static uint32_t crc_table[CRC32_SLICES][256];
+
+// Builds the slice-by-8 lookup tables
+void set_up_crc32() {
+    for(int byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte;
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32_POLYNOMIAL : 0);
+        }
+        crc_table[0][byte] = crc;
+    }
+    for(int byte = 0; byte < 256; byte++) {
+        for(int slice = 1; slice < CRC32_SLICES; slice++) {
+            uint32_t crc = crc_table[slice - 1][byte];
+            crc_table[slice][byte] = (crc >> 8) ^ crc_table[0][crc & 0xFF];
+        }
+    }
+}
+
+// Computes the CRC one bit at a time. Slow, but independent of the tables, so it is used as the reference
+// when verifying them.
+static uint32_t crc32_update_reference(uint32_t crc, const unsigned char *data, size_t num_bytes) {
+    crc = ~crc;
+    for(size_t n = 0; n < num_bytes; n++) {
+        crc ^= data[n];
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32_POLYNOMIAL : 0);
+        }
+    }
+    return ~crc;
+}
+
+// Continues a CRC-32 over more data one byte at a time with a single table. Start with crc 0.
+uint32_t crc32_update_bytewise(uint32_t crc, const unsigned char *data, size_t num_bytes) {
+    crc = ~crc;
+    while(num_bytes-- > 0) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+}
+
+// Continues a CRC-32 over more data, 8 bytes per step. Start with crc 0, the CRC of data split over several
+// calls is the same as of the data in one piece. The words are put together from bytes, which compiles to
+// plain (unaligned) loads on little endian ARM and x86 and keeps the result independent of the byte order.
+uint32_t crc32_update(uint32_t crc, const unsigned char *data, size_t num_bytes) {
+    crc = ~crc;
+    while(num_bytes >= 8) {
+        uint32_t low = crc ^ (data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24);
+        uint32_t high = data[4] | data[5] << 8 | data[6] << 16 | (uint32_t)data[7] << 24;
+        crc = crc_table[7][low & 0xFF] ^ crc_table[6][(low >> 8) & 0xFF] ^
+              crc_table[5][(low >> 16) & 0xFF] ^ crc_table[4][low >> 24] ^
+              crc_table[3][high & 0xFF] ^ crc_table[2][(high >> 8) & 0xFF] ^
+              crc_table[1][(high >> 16) & 0xFF] ^ crc_table[0][high >> 24];
+        data += 8;
+        num_bytes -= 8;
+    }
+    while(num_bytes-- > 0) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+}
+
+// Checks the table-driven CRCs against the bit at a time CRC for every length and alignment of some
+// pseudo-random data, fed in one piece and split in two. Returns 0 if all of them match.
+int verify_crc32() {
+    unsigned char data[CRC32_VERIFY_BYTES];
+    uint32_t state = 1;
+
+    if(crc32_update(0, (const unsigned char *)"123456789", 9) != CRC32_CHECK) {
+        return -1;
+    }
+    fill_pseudo_random(data, CRC32_VERIFY_BYTES, &state);
+    for(size_t first = 0; first < CRC32_SLICES; first++) {
+        for(size_t num_bytes = 0; first + num_bytes <= CRC32_VERIFY_BYTES; num_bytes++) {
+            uint32_t reference = crc32_update_reference(0, data + first, num_bytes);
+            size_t split = num_bytes / 3;
+            if(crc32_update(0, data + first, num_bytes) != reference ||
+               crc32_update_bytewise(0, data + first, num_bytes) != reference ||
+               crc32_update(crc32_update(0, data + first, split), data + first + split, num_bytes - split) != reference) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
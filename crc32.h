@@ -0,0 +1,21 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-32 configuration. The same CRC as Ethernet, gzip and zlib (reflected polynomial 0x04C11DB7, initial value and
+// final XOR 0xFFFFFFFF), so a receiver can check frames with any zlib style crc32. The Cortex-A9 has no CRC
+// instructions, so it is computed slice-by-8: 8 lookup tables of 256 entries consume 8 bytes per step.
+#define CRC32_POLYNOMIAL 0xEDB88320     // Bit reversed 0x04C11DB7
+#define CRC32_SLICES 8
+#define CRC32_CHECK 0xCBF43926          // CRC of the ASCII string "123456789"
+#define CRC32_VERIFY_BYTES 263          // Data checked by verify_crc32, 32 slice steps and a 7 byte tail
+
+// Function prototypes
+void set_up_crc32();
+int verify_crc32();
+uint32_t crc32_update(uint32_t crc, const unsigned char *data, size_t num_bytes);
+uint32_t crc32_update_bytewise(uint32_t crc, const unsigned char *data, size_t num_bytes);
+
+#endif /* CRC32_H */
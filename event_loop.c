@@ -0,0 +1,188 @@
+/* Event driven transmit loop with non-blocking pushes for MARLIN SDR */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "transmitter.h"
+
+// Control eventfd, written to wake the event loop
+static int control_fd = -1;
+
+// Wakes the event loop so that it sees the running flag was cleared. Safe to call from a signal handler.
+void wake_event_loop() {
+    uint64_t one = 1;
+    ssize_t ret;
+    if(control_fd >= 0) {
+        ret = write(control_fd, &one, sizeof(one));
+        (void)ret;      // Nothing to do if the counter is already set
+    }
+}
+
+// Transmit data framed by a framer from a single thread that sleeps in poll until the input has data, the
+// kernel buffer queue has room or the loop is woken. Each chunk of data is framed once it is complete and its
+// frames are streamed into the transmit buffer, straight into it when they fit. The buffer is pushed whenever
+// it is full, and what is left of a short chunk (the end of the data, or a partial chunk of a stream sent once
+// its first data waited for the stream flush time) is pushed as a short buffer. Mapped input never blocks, so
+// it is read as soon as a chunk is needed. Returns 0 once all data has been pushed or the transmission is
+// interrupted, the negative error code of a push that failed, or EVENT_LOOP_UNSUPPORTED without transmitting
+// if the backend does not support non-blocking pushes.
+int transmit_event_loop(struct data_input *input, struct framer *framer) {
+    struct pollfd fds[NUM_EVENT_FDS];
+    size_t buffer_samples = tx_buffer_samples();
+    size_t num_data_bytes = 0;
+    size_t fill = 0;                    // Samples already in the transmit buffer
+    size_t num_push = 0;                // Samples to push once the kernel buffer queue has room
+    size_t num_pending = 0, num_copied;
+    off_t total_data_bytes = 0;
+    bool end_of_input = false, packet_ready = false, packet_framed = false, push_ready = false;
+    unsigned long long wakeups = 0, pushes = 0, retries = 0;
+    unsigned char *buffer;
+    uint32_t *samples;
+    const unsigned char *data;
+    const uint32_t *pending;            // Frames of the chunk not yet in the transmit buffer
+    struct input_window *window = NULL;
+    uint64_t count;
+    ssize_t nbytes;
+    long long flush_time = 0;
+    int buffer_fd, input_fd, timeout_ms, ret, result = 0;
+
+    buffer_fd = get_tx_buffer_poll_fd();
+    if(buffer_fd < 0 || set_tx_buffer_blocking(false) < 0) {
+        return EVENT_LOOP_UNSUPPORTED;
+    }
+    if(control_fd < 0) {
+        control_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        less_than_zero_error_check(control_fd, "control_fd");
+    }
+    nbytes = read(control_fd, &count, sizeof(count));     // Clear a wake up left from an earlier transmission
+    buffer = malloc(framer->chunk_data_bytes);
+    null_error_check((void *)buffer, "packet data");
+    samples = malloc(framer->chunk_samples * sizeof(uint32_t));
+    null_error_check((void *)samples, "packet samples");
+    data = buffer;
+    pending = samples;
+
+    fds[EVENT_FD_CONTROL].fd = control_fd;
+    fds[EVENT_FD_CONTROL].events = POLLIN;
+    fds[EVENT_FD_BUFFER].fd = buffer_fd;
+    fds[EVENT_FD_INPUT].fd = input_fd = get_data_input_poll_fd(input);    // poll skips negative fds
+
+    enter_realtime_push_thread();
+    while(running) {
+        if(!packet_ready && input_fd < 0) {
+            num_data_bytes = read_data_input(input, buffer, framer->chunk_data_bytes, &data, &window);
+            total_data_bytes += num_data_bytes;
+            end_of_input = input->end;
+            packet_ready = true;
+        }
+
+        // Frame a complete chunk, then stream its frames into the transmit buffer until it is full
+        if(packet_ready && !push_ready) {
+            if(!packet_framed) {
+                if(fill + framer->chunk_samples <= buffer_samples) {
+                    fill += frame_chunk(framer, data, num_data_bytes, end_of_input, tx_buffer_first() + fill);
+                } else {
+                    num_pending = frame_chunk(framer, data, num_data_bytes, end_of_input, samples);
+                    pending = samples;
+                }
+                release_input_window(window);
+                window = NULL;
+                packet_framed = true;
+            }
+            num_copied = fill_tx_buffer(fill, pending, num_pending);
+            fill += num_copied;
+            pending += num_copied;
+            num_pending -= num_copied;
+            if(fill == buffer_samples) {
+                num_push = fill;
+                push_ready = true;
+            } else if(num_pending == 0 && fill > 0 && (end_of_input || num_data_bytes < framer->chunk_data_bytes)) {
+                num_push = pad_tx_buffer(fill);
+                push_ready = true;
+            }
+            if(num_pending == 0 && !end_of_input) {
+                num_data_bytes = 0;     // Collect the next chunk while the buffer waits to be pushed
+                packet_ready = false;
+                packet_framed = false;
+            }
+        }
+        if(end_of_input && packet_framed && num_pending == 0 && !push_ready) {
+            break;
+        }
+        if(!packet_ready && !push_ready && input_fd < 0) {
+            continue;       // Read the next chunk of mapped input straight away, there is nothing to poll for
+        }
+
+        // Wait for data of the next chunk and for room in the kernel buffer queue
+        fds[EVENT_FD_BUFFER].events = push_ready ? POLLOUT : 0;
+        fds[EVENT_FD_INPUT].events = packet_ready ? 0 : POLLIN;
+        timeout_ms = -1;
+        if(!packet_ready && num_data_bytes > 0 && input->mode == INPUT_STREAM) {
+            timeout_ms = flush_time > monotonic_ms() ? (int)(flush_time - monotonic_ms()) : 0;
+        }
+        if((ret = poll(fds, NUM_EVENT_FDS, timeout_ms)) < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            printf("error: poll failed\n");
+            exit(0);
+        }
+        wakeups++;
+
+        if(fds[EVENT_FD_CONTROL].revents) {
+            break;
+        }
+        if(ret == 0) {
+            packet_ready = true;    // Flush the partial chunk of a stream
+            continue;
+        }
+        if(!packet_ready && fds[EVENT_FD_INPUT].revents) {
+            nbytes = read_stream_data(input, buffer, num_data_bytes, framer->chunk_data_bytes);
+            if(nbytes < 0) {
+                packet_ready = true;    // The next datagram does not fit, send the partial chunk first
+            } else {
+                if(num_data_bytes == 0) {
+                    flush_time = monotonic_ms() + get_stream_flush_ms();
+                }
+                num_data_bytes += nbytes;
+                total_data_bytes += nbytes;
+                end_of_input = input->end;
+                packet_ready = end_of_input || num_data_bytes == framer->chunk_data_bytes;
+            }
+        }
+        if(push_ready && fds[EVENT_FD_BUFFER].revents) {
+            nbytes = push_tx_buffer_samples(num_push);
+            if(nbytes == -EAGAIN) {     // Queue filled up again before the push, wait for the next POLLOUT
+                retries++;
+                continue;
+            }
+            if(nbytes < 0) {
+                print_push_error(nbytes);
+                result = (int)nbytes;
+                break;
+            }
+            pushes++;
+            print_transmit_progress(total_data_bytes, input->size);
+            fill = 0;
+            push_ready = false;
+        }
+    }
+    leave_realtime_push_thread();
+    printf("\n");   // Needed since print_transmit_progress does not print a newline character
+
+    set_tx_buffer_blocking(true);
+    release_input_window(window);
+    free(buffer);
+    free(samples);
+    printf("Event loop: %llu wake ups, %llu pushes, %llu pushes retried\n", wakeups, pushes, retries);
+    return result;
+}
+
+// Closes the control eventfd
+void shut_down_event_loop() {
+    if(control_fd >= 0) {
+        close(control_fd);
+        control_fd = -1;
+    }
+}
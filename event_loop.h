@@ -0,0 +1,24 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "framing.h"
+#include "input.h"
+
+// File descriptors watched by the event loop
+enum event_loop_fd {
+    EVENT_FD_CONTROL,       // Readable when the loop is woken, e.g. by ctrl + c
+    EVENT_FD_BUFFER,        // Writable when the kernel buffer queue has room for a push
+    EVENT_FD_INPUT,         // Readable when transmission data is available, unused for mapped input
+    NUM_EVENT_FDS
+};
+
+#define EVENT_LOOP_UNSUPPORTED 1     // Returned by transmit_event_loop if the backend cannot push without blocking
+
+// Function prototypes
+int transmit_event_loop(struct data_input *input, struct framer *framer);
+void wake_event_loop();
+void shut_down_event_loop();
+
+#endif /* EVENT_LOOP_H */
@@ -0,0 +1,289 @@
+/* Packet framing for MARLIN SDR */
+
+#include <stdlib.h>
+#include <string.h>
+#include "transmitter.h"
+
+// Pre-modulated preamble and sync word of each modulation. Built the first time a modulation
+// transmits and copied into every packet, so the constant header is not modulated per packet.
+static uint32_t *header_samples[NUM_MODULATIONS];
+static size_t header_num_samples[NUM_MODULATIONS];
+
+// Payload of a full frame, 0 for one frame per transmit buffer
+static size_t frame_bytes = 0;
+
+// Coded payload and CRC of the frame being built, and its Reed-Solomon codewords before the convolutional code,
+// grown to the largest frame
+static unsigned char *coded_payload = NULL;
+static size_t coded_payload_bytes = 0;
+static unsigned char *outer_payload = NULL;
+static size_t outer_payload_bytes = 0;
+
+// Returns the modulated preamble and sync word of a constellation and sets num_samples to their length.
+// The samples are built on first use and kept until clear_header_samples is called.
+const uint32_t *get_header_samples(const struct constellation *c, size_t *num_samples) {
+    if(header_samples[c->id] == NULL) {
+        header_num_samples[c->id] = sync_header_samples(c);
+        header_samples[c->id] = malloc(header_num_samples[c->id] * sizeof(uint32_t));
+        null_error_check((void *)header_samples[c->id], "header_samples");
+        build_sync_header(c, header_samples[c->id]);
+    }
+
+    *num_samples = header_num_samples[c->id];
+    return header_samples[c->id];
+}
+
+// Frees the modulated headers so they are rebuilt, needed whenever the header configuration changes
+void clear_header_samples() {
+    for(int id = 0; id < NUM_MODULATIONS; id++) {
+        free(header_samples[id]);
+        header_samples[id] = NULL;
+        header_num_samples[id] = 0;
+    }
+}
+
+// Returns the number of samples before the payload of a frame: the preamble, sync word and frame header
+size_t frame_header_samples(const struct constellation *c) {
+    size_t num_header_samples;
+    get_header_samples(c, &num_header_samples);
+    return num_header_samples + constellation_symbols(c, FRAME_HEADER_BYTES);
+}
+
+// Returns true if frame payloads are coded, with the Reed-Solomon outer code, a convolutional code or both
+static bool is_payload_coded() {
+    return get_rs_block_bytes() != 0 || get_code_rate() != CODE_RATE_NONE;
+}
+
+// Returns the number of bytes the payload and CRC of a frame take in the bit stream, after coding
+static size_t frame_payload_bytes(size_t num_data_bytes) {
+    return conv_coded_bytes(get_code_rate(), rs_coded_bytes(num_data_bytes + FRAME_CRC_BYTES));
+}
+
+// Returns the number of data bytes a packet of num_samples holds after the preamble, sync word and frame header,
+// leaving room for the CRC, or 0 if there is no room. Packets hold whole groups of 8 symbols of (coded) data and
+// CRC so that the bit stream is not padded in the middle of a packet.
+size_t packet_data_bytes(const struct constellation *c, size_t num_samples) {
+    size_t num_bytes = rs_data_bytes(conv_data_bytes(get_code_rate(),
+                                                     constellation_bytes(c, num_samples - frame_header_samples(c))));
+    return num_bytes > FRAME_CRC_BYTES ? num_bytes - FRAME_CRC_BYTES : 0;
+}
+
+// Fills a byte array with the frame header of a frame
+static void build_frame_header_bytes(unsigned char *header, const struct constellation *c, uint16_t sequence,
+                                     bool last, size_t num_data_bytes) {
+    header[0] = c->id;
+    header[1] = (last ? FRAME_FLAG_LAST : 0) | get_code_rate() << FRAME_CODE_RATE_SHIFT |
+                (get_rs_block_bytes() != 0 ? FRAME_FLAG_RS : 0);
+    header[2] = (sequence >> 8) & 0xFF;
+    header[3] = sequence & 0xFF;
+    header[4] = (num_data_bytes >> 24) & 0xFF;
+    header[5] = (num_data_bytes >> 16) & 0xFF;
+    header[6] = (num_data_bytes >> 8) & 0xFF;
+    header[7] = num_data_bytes & 0xFF;
+}
+
+// Checksums and modulates data that fills whole groups of 8 symbols, continuing crc. Each block is checksummed
+// just before it is modulated, so the CRC reads it from memory and the modulator finds it in the cache.
+// With parallel modulation the data is modulated in one piece to keep the threads busy.
+static uint32_t checksum_and_modulate(const struct constellation *c, const unsigned char *data, size_t num_data_bytes,
+                                      uint32_t crc, uint32_t *samples) {
+    size_t block_bytes = FRAME_CRC_BLOCK_GROUPS * c->bits_per_symbol;
+    size_t num_block_bytes;
+
+    if(get_modulation_threads() > 1) {
+        block_bytes = num_data_bytes;
+    }
+    while(num_data_bytes > 0) {
+        num_block_bytes = num_data_bytes < block_bytes ? num_data_bytes : block_bytes;
+        crc = crc32_update(crc, data, num_block_bytes);
+        modulate_and_pad(c, data, num_block_bytes, samples, samples + constellation_symbols(c, num_block_bytes));
+        samples += constellation_symbols(c, num_block_bytes);
+        data += num_block_bytes;
+        num_data_bytes -= num_block_bytes;
+    }
+    return crc;
+}
+
+// Writes a CRC into 4 bytes, big endian
+static void put_crc_bytes(unsigned char *bytes, uint32_t crc) {
+    bytes[0] = (crc >> 24) & 0xFF;
+    bytes[1] = (crc >> 16) & 0xFF;
+    bytes[2] = (crc >> 8) & 0xFF;
+    bytes[3] = crc & 0xFF;
+}
+
+// Grows a payload buffer to hold num_bytes
+static void grow_payload(unsigned char **payload, size_t *payload_bytes, size_t num_bytes, char *name) {
+    if(num_bytes > *payload_bytes) {
+        free(*payload);
+        *payload = malloc(num_bytes);
+        null_error_check((void *)*payload, name);
+        *payload_bytes = num_bytes;
+    }
+}
+
+// Encodes more data of a frame with the outer code, the inner code or both. With both, the codewords written
+// by the outer encoder since read are passed on to the inner encoder while they are still in the cache.
+static void encode_payload(struct rs_encoder *outer, struct conv_encoder *inner, const unsigned char **read,
+                           const unsigned char *data, size_t num_bytes) {
+    if(get_rs_block_bytes() == 0) {
+        conv_encode(inner, data, num_bytes);
+        return;
+    }
+    rs_encode(outer, data, num_bytes);
+    if(get_code_rate() != CODE_RATE_NONE) {
+        conv_encode(inner, *read, outer->coded - *read);
+        *read = outer->coded;
+    }
+}
+
+// Checksums and encodes the data of a frame and then its CRC into coded_payload, continuing crc. The data goes
+// through the Reed-Solomon outer code and then the convolutional code, whichever are set. Like
+// checksum_and_modulate, each block is checksummed just before the encoders read it.
+// Returns the number of coded bytes.
+static size_t checksum_and_encode(const struct constellation *c, const unsigned char *data, size_t num_data_bytes,
+                                  uint32_t crc) {
+    size_t block_bytes = FRAME_CRC_BLOCK_GROUPS * c->bits_per_symbol;
+    size_t num_block_bytes, num_outer_bytes = rs_coded_bytes(num_data_bytes + FRAME_CRC_BYTES);
+    unsigned char crc_bytes[FRAME_CRC_BYTES];
+    const unsigned char *read;
+    struct rs_encoder outer;
+    struct conv_encoder inner;
+
+    grow_payload(&coded_payload, &coded_payload_bytes, frame_payload_bytes(num_data_bytes), "coded_payload");
+    if(get_rs_block_bytes() != 0 && get_code_rate() != CODE_RATE_NONE) {
+        grow_payload(&outer_payload, &outer_payload_bytes, num_outer_bytes, "outer_payload");
+        start_rs_encoder(&outer, outer_payload);
+    } else {
+        start_rs_encoder(&outer, coded_payload);
+    }
+    start_conv_encoder(&inner, get_code_rate(), coded_payload);
+    read = outer.coded;
+    while(num_data_bytes > 0) {
+        num_block_bytes = num_data_bytes < block_bytes ? num_data_bytes : block_bytes;
+        crc = crc32_update(crc, data, num_block_bytes);
+        encode_payload(&outer, &inner, &read, data, num_block_bytes);
+        data += num_block_bytes;
+        num_data_bytes -= num_block_bytes;
+    }
+    put_crc_bytes(crc_bytes, crc);
+    encode_payload(&outer, &inner, &read, crc_bytes, FRAME_CRC_BYTES);
+
+    if(get_rs_block_bytes() == 0) {
+        return finish_conv_encoder(&inner);
+    }
+    num_outer_bytes = finish_rs_encoder(&outer);
+    if(get_code_rate() == CODE_RATE_NONE) {
+        return num_outer_bytes;
+    }
+    conv_encode(&inner, read, outer.coded - read);      // Parity of the shortened last codeword
+    return finish_conv_encoder(&inner);
+}
+
+// Builds the samples of a packet: the cached preamble and sync word, the frame header, the modulated data and
+// CRC (coded if a code is set), and padding with 0's. A packet with fewer data bytes than fit in num_samples (the end of the transmission
+// or a flushed stream) is cut short after its CRC instead of being padded to num_samples.
+// Returns the number of samples of the packet.
+size_t build_packet_samples(const struct constellation *c, const unsigned char *data, size_t num_data_bytes,
+                            uint16_t sequence, bool last, uint32_t *samples, size_t num_samples) {
+    unsigned char frame_header[FRAME_HEADER_BYTES];
+    unsigned char tail[MAX_BITS_PER_SYMBOL + FRAME_CRC_BYTES];     // Data after the last whole group, then the CRC
+    size_t num_header_samples, num_frame_samples;
+    size_t num_group_bytes = num_data_bytes / c->bits_per_symbol * c->bits_per_symbol;
+    size_t num_tail_bytes = num_data_bytes - num_group_bytes;
+    const uint32_t *header = get_header_samples(c, &num_header_samples);
+    uint32_t *data_samples = samples + frame_header_samples(c);
+    uint32_t *tail_samples = data_samples + constellation_symbols(c, num_group_bytes);
+    uint32_t crc;
+
+    memcpy(samples, header, num_header_samples * sizeof(uint32_t));
+    build_frame_header_bytes(frame_header, c, sequence, last, num_data_bytes);
+    map_bytes(c, frame_header, FRAME_HEADER_BYTES, samples + num_header_samples);
+
+    num_frame_samples = num_samples;
+    if(num_data_bytes < packet_data_bytes(c, num_samples)) {
+        num_frame_samples = frame_header_samples(c) + constellation_symbols(c, frame_payload_bytes(num_data_bytes));
+        num_frame_samples = (num_frame_samples + FRAME_SAMPLES_MULTIPLE - 1) / FRAME_SAMPLES_MULTIPLE * FRAME_SAMPLES_MULTIPLE;
+        if(num_frame_samples > num_samples) {
+            num_frame_samples = num_samples;
+        }
+    }
+
+    crc = crc32_update(0, frame_header, FRAME_HEADER_BYTES);
+    if(is_payload_coded()) {
+        modulate_and_pad(c, coded_payload, checksum_and_encode(c, data, num_data_bytes, crc), data_samples,
+                         samples + num_frame_samples);
+        return num_frame_samples;
+    }
+
+    // The CRC goes right after the data in the bit stream, so a partial last group of data is modulated
+    // together with it
+    crc = checksum_and_modulate(c, data, num_group_bytes, crc, data_samples);
+    crc = crc32_update(crc, data + num_group_bytes, num_tail_bytes);
+    memcpy(tail, data + num_group_bytes, num_tail_bytes);
+    put_crc_bytes(tail + num_tail_bytes, crc);
+    modulate_and_pad(c, tail, num_tail_bytes + FRAME_CRC_BYTES, tail_samples, samples + num_frame_samples);
+    return num_frame_samples;
+}
+
+// Sets the payload of a full frame, 0 for one frame per transmit buffer. Exits if it is out of range.
+void set_frame_bytes(size_t num_bytes) {
+    if(num_bytes != 0 && (num_bytes < MIN_FRAME_BYTES || num_bytes > MAX_FRAME_BYTES)) {
+        printf("error: frame payload must be between %d and %d bytes\n", MIN_FRAME_BYTES, MAX_FRAME_BYTES);
+        exit(0);
+    }
+    frame_bytes = num_bytes;
+}
+
+// Returns the payload of a full frame, 0 for one frame per transmit buffer
+size_t get_frame_bytes() {
+    return frame_bytes;
+}
+
+// Sets up framing data with a constellation for transmit buffers of buffer_samples. The payload and CRC of a full
+// frame are rounded down to whole groups of 8 symbols, so frames are not padded in the middle of the stream.
+void set_up_framer(struct framer *f, const struct constellation *c, size_t buffer_samples) {
+    size_t group_bytes = c->bits_per_symbol;    // Bytes of a group of 8 symbols
+    size_t frames_per_chunk;
+
+    f->c = c;
+    f->sequence = 0;
+    if(frame_bytes == 0) {
+        if(buffer_samples <= frame_header_samples(c) || packet_data_bytes(c, buffer_samples) == 0) {
+            printf("error: no room for data after the preamble and sync word in a buffer of %zu samples,\n", buffer_samples);
+            printf("make the buffers longer with -n or frame independently of them with -f\n");
+            exit(0);
+        }
+        f->frame_samples = buffer_samples;
+        f->frame_data_bytes = packet_data_bytes(c, buffer_samples);
+    } else {
+        f->frame_data_bytes = (frame_bytes + FRAME_CRC_BYTES) / group_bytes * group_bytes - FRAME_CRC_BYTES;
+        if(is_payload_coded()) {
+            f->frame_data_bytes = frame_bytes;      // Coded frames end mid group anyway
+        }
+        f->frame_samples = frame_header_samples(c) + constellation_symbols(c, frame_payload_bytes(f->frame_data_bytes));
+    }
+    frames_per_chunk = buffer_samples / f->frame_samples;
+    if(frames_per_chunk == 0) {
+        frames_per_chunk = 1;       // Frames longer than a transmit buffer
+    }
+    f->chunk_data_bytes = frames_per_chunk * f->frame_data_bytes;
+    f->chunk_samples = frames_per_chunk * f->frame_samples;
+}
+
+// Frames a chunk of up to chunk_data_bytes of data into samples. A short chunk (the end of the transmission or
+// a flushed stream) ends with a short frame, and an empty last chunk is sent as an empty last frame.
+// Returns the number of samples written, at most chunk_samples.
+size_t frame_chunk(struct framer *f, const unsigned char *data, size_t num_data_bytes, bool last, uint32_t *samples) {
+    size_t num_samples = 0, num_frame_bytes;
+
+    do {
+        num_frame_bytes = num_data_bytes < f->frame_data_bytes ? num_data_bytes : f->frame_data_bytes;
+        num_data_bytes -= num_frame_bytes;
+        num_samples += build_packet_samples(f->c, data, num_frame_bytes, f->sequence++, last && num_data_bytes == 0,
+                                            samples + num_samples, f->frame_samples);
+        data += num_frame_bytes;
+    } while(num_data_bytes > 0);
+
+    return num_samples;
+}
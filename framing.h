@@ -0,0 +1,51 @@
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "modulation.h"
+
+// Frame header configuration. Every frame starts with the preamble and sync word (see sync_header.h), followed by the frame header
+// and the payload. The frame header is big endian: modulation ID (1 byte), flags (1 byte), sequence number
+// (2 bytes, counts the frames of a transmission from 0 and wraps) and payload length in bytes (4 bytes).
+// The payload is followed by the CRC-32 of the frame header and payload (big endian, see crc32.h).
+// Everything after the CRC is padding, which a receiver can drop using the length. With a code rate set, the
+// payload and CRC are sent convolutionally coded (see convolutional.h) and the length is still of the data.
+// With the Reed-Solomon outer code, the payload and CRC are split into codewords (see reed_solomon.h) before
+// the convolutional code.
+#define FRAME_HEADER_BYTES 8
+#define FRAME_CRC_BYTES 4
+#define FRAME_CRC_BLOCK_GROUPS 512      // Groups of 8 symbols checksummed and then modulated or encoded at a time
+#define FRAME_FLAG_LAST 0x01            // Last frame of the transmission
+#define FRAME_CODE_RATE_SHIFT 1         // Flag bits 1 to 3 hold the code rate (enum code_rate, 0 for uncoded)
+#define FRAME_FLAG_RS 0x10              // Payload has the Reed-Solomon outer code, codeword length set at both ends
+#define FRAME_SAMPLES_MULTIPLE 8        // A short frame is padded to a multiple of this many samples for the DMA
+#define MIN_FRAME_BYTES 16              // Smallest payload of a full frame given with set_frame_bytes
+#define MAX_FRAME_BYTES (16 * 1024 * 1024)
+
+// Splits transmission data into frames written back to back as one continuous stream of samples, independent
+// of the transmit buffers the stream is pushed in. Data is framed a chunk at a time. A chunk is a whole number
+// of frames about one transmit buffer long, so frames never have to be put together from two chunks.
+struct framer {
+    const struct constellation *c;
+    size_t frame_samples;           // Samples of a full frame
+    size_t frame_data_bytes;        // Payload of a full frame, without the CRC
+    size_t chunk_data_bytes;        // Data framed at a time
+    size_t chunk_samples;           // Most samples a chunk is framed into
+    uint16_t sequence;              // Sequence number of the next frame
+};
+
+// Function prototypes
+const uint32_t *get_header_samples(const struct constellation *c, size_t *num_samples);
+void clear_header_samples();
+size_t frame_header_samples(const struct constellation *c);
+size_t packet_data_bytes(const struct constellation *c, size_t num_samples);
+size_t build_packet_samples(const struct constellation *c, const unsigned char *data, size_t num_data_bytes,
+                            uint16_t sequence, bool last, uint32_t *samples, size_t num_samples);
+void set_frame_bytes(size_t num_bytes);
+size_t get_frame_bytes();
+void set_up_framer(struct framer *f, const struct constellation *c, size_t buffer_samples);
+size_t frame_chunk(struct framer *f, const unsigned char *data, size_t num_data_bytes, bool last, uint32_t *samples);
+
+#endif /* FRAMING_H */
@@ -0,0 +1,96 @@
+/* Compressed (gzip and zlib) file input for MARLIN SDR */
+
+#include <errno.h>
+#include "transmitter.h"
+
+// Returns true if a regular file starts with a gzip header (deflate, no reserved flags set) or a zlib header
+// (deflate with at most a 32 kB window, header check bits right and no preset dictionary).
+// The header is read with pread so the file position is left alone.
+bool is_compressed_file(FILE *fp) {
+    unsigned char magic[4];
+
+    if(pread(fileno(fp), magic, sizeof(magic), 0) != sizeof(magic)) {
+        return false;
+    }
+    if(magic[0] == 0x1f && magic[1] == 0x8b) {
+        return magic[2] == Z_DEFLATED && (magic[3] & GZIP_RESERVED_FLAGS) == 0;
+    }
+    return (magic[0] & 0x0F) == Z_DEFLATED && (magic[0] >> 4) <= ZLIB_MAX_WINDOW_INFO &&
+           ((magic[0] << 8) | magic[1]) % 31 == 0 && (magic[1] & ZLIB_PRESET_DICTIONARY) == 0;
+}
+
+// Sets up inflating a compressed file from its start
+void open_inflate_input(struct inflate_input *in, FILE *fp) {
+    in->fd = fileno(fp);
+    in->done = false;
+    in->error = false;
+    in->chunk = malloc(INFLATE_CHUNK_BYTES);
+    null_error_check((void *)in->chunk, "inflate chunk");
+    memset(&in->strm, 0, sizeof(in->strm));
+    if(inflateInit2(&in->strm, INFLATE_WINDOW_BITS) != Z_OK) {
+        printf("error: could not set up inflate\n");
+        exit(0);
+    }
+    lseek(in->fd, 0, SEEK_SET);
+}
+
+// Stops inflating after an error, the data inflated so far is still returned
+static void fail_inflate_input(struct inflate_input *in) {
+    in->done = true;
+    in->error = true;
+}
+
+// Reads the next chunk of compressed data. Returns the number of bytes read, 0 at the end of the file
+// or if reading fails.
+static size_t read_chunk(struct inflate_input *in) {
+    ssize_t nbytes;
+
+    do {
+        nbytes = read(in->fd, in->chunk, INFLATE_CHUNK_BYTES);
+    } while(nbytes < 0 && errno == EINTR);
+    if(nbytes < 0) {
+        printf("\nerror: could not read the compressed input (%s)\n", strerror(errno));
+        fail_inflate_input(in);
+        nbytes = 0;
+    }
+    in->strm.next_in = in->chunk;
+    in->strm.avail_in = nbytes;
+    return nbytes;
+}
+
+// Inflates up to max_bytes of data into buffer, fewer only at the end of the file. Files made of several
+// concatenated gzip members (cat a.gz b.gz) are inflated one member after the other. A file that cannot be
+// read, is truncated or is corrupt ends early with the error flag set.
+size_t read_inflate_input(struct inflate_input *in, unsigned char *buffer, size_t max_bytes) {
+    int ret;
+
+    in->strm.next_out = buffer;
+    in->strm.avail_out = max_bytes;
+    while(in->strm.avail_out > 0 && !in->done) {
+        if(in->strm.avail_in == 0 && read_chunk(in) == 0) {
+            if(!in->error) {
+                printf("\nerror: compressed input is truncated\n");
+                fail_inflate_input(in);
+            }
+            break;
+        }
+        ret = inflate(&in->strm, Z_NO_FLUSH);
+        if(ret == Z_STREAM_END) {
+            if(in->strm.avail_in == 0 && read_chunk(in) == 0) {
+                in->done = true;    // Also set if reading fails
+            } else {
+                inflateReset(&in->strm);    // Another member follows
+            }
+        } else if(ret != Z_OK && ret != Z_BUF_ERROR) {
+            printf("\nerror: compressed input is corrupt (%s)\n", in->strm.msg ? in->strm.msg : zError(ret));
+            fail_inflate_input(in);
+        }
+    }
+    return max_bytes - in->strm.avail_out;
+}
+
+// Stops inflating, the file itself is closed by the caller
+void close_inflate_input(struct inflate_input *in) {
+    inflateEnd(&in->strm);
+    free(in->chunk);
+}
@@ -0,0 +1,33 @@
+#ifndef INFLATE_INPUT_H
+#define INFLATE_INPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+// Compressed input configuration. Files are inflated as they are transmitted, so memory use is the
+// inflate state (32 kB window) plus one chunk of compressed data however large the file is.
+#define INFLATE_CHUNK_BYTES (64 * 1024)     // Compressed bytes read at a time
+#define INFLATE_WINDOW_BITS (15 + 32)       // Largest window, gzip or zlib header detected automatically
+#define GZIP_RESERVED_FLAGS 0xE0            // gzip flag bits that must be 0
+#define ZLIB_MAX_WINDOW_INFO 7              // zlib window size field of a 32 kB window
+#define ZLIB_PRESET_DICTIONARY 0x20         // zlib flag of a stream needing a preset dictionary, not supported
+
+// A gzip or zlib compressed file inflated as it is read
+struct inflate_input {
+    int fd;
+    z_stream strm;
+    unsigned char *chunk;       // Compressed data not yet inflated
+    bool done;                  // Last member inflated, or inflating failed
+    bool error;                 // The file could not be read, is truncated or is corrupt
+};
+
+// Function prototypes
+bool is_compressed_file(FILE *fp);
+void open_inflate_input(struct inflate_input *in, FILE *fp);
+size_t read_inflate_input(struct inflate_input *in, unsigned char *buffer, size_t max_bytes);
+void close_inflate_input(struct inflate_input *in);
+
+#endif /* INFLATE_INPUT_H */
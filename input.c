@@ -0,0 +1,222 @@
+/* Transmission data input for MARLIN SDR */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "transmitter.h"
+
+// Time a partial packet of a stream waits for more data before it is sent
+static int stream_flush_ms = DEFAULT_STREAM_FLUSH_MS;
+
+// Sets the time a partial packet of a stream waits for more data. Exits if it is out of range.
+void set_stream_flush_ms(int flush_ms) {
+    if(flush_ms < 1 || flush_ms > MAX_STREAM_FLUSH_MS) {
+        printf("error: stream flush time must be between 1 and %d ms\n", MAX_STREAM_FLUSH_MS);
+        exit(0);
+    }
+    stream_flush_ms = flush_ms;
+}
+
+// Returns the time a partial packet of a stream waits for more data
+int get_stream_flush_ms() {
+    return stream_flush_ms;
+}
+
+// Returns a monotonic clock in milliseconds
+long long monotonic_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+// Reads the next datagram of a datagram socket into buffer, which has room for max_bytes. Datagrams are
+// kept whole: returns -1 without reading if the datagram does not fit after num_bytes already read.
+// A datagram longer than a whole packet is cut to max_bytes. An empty datagram ends the stream (returns 0),
+// and so does a failed read, which sets the error flag as well.
+static ssize_t read_datagram(struct data_input *in, unsigned char *buffer, size_t max_bytes, size_t num_bytes) {
+    int fd = fileno(in->fp);
+    int pending = 0;
+    ssize_t nbytes;
+
+    if(num_bytes > 0 && ioctl(fd, FIONREAD, &pending) == 0 && (size_t)pending > max_bytes) {
+        return -1;
+    }
+    do {
+        nbytes = recv(fd, buffer, max_bytes, MSG_TRUNC);
+    } while(nbytes < 0 && errno == EINTR);
+    if(nbytes < 0) {
+        printf("\nerror: could not receive the input (%s)\n", strerror(errno));
+        in->error = true;
+        return 0;
+    }
+    if((size_t)nbytes > max_bytes) {
+        printf("warning: %zd byte datagram cut to the %zu bytes left in the packet\n", nbytes, max_bytes);
+        nbytes = max_bytes;
+    }
+    return nbytes;
+}
+
+// Reads the data waiting on a stream into buffer after the num_bytes already in it, up to max_bytes in
+// total. Reads once, so it only blocks if poll did not report the stream readable. Sets the end flag at
+// the end of the stream, and the error flag as well if the read fails. Returns the bytes read, or -1 if the next datagram does not fit after the data
+// already in buffer, in which case the partial packet has to be sent first.
+ssize_t read_stream_data(struct data_input *in, unsigned char *buffer, size_t num_bytes, size_t max_bytes) {
+    int fd = fileno(in->fp);
+    ssize_t nbytes;
+
+    if(in->datagram) {
+        nbytes = read_datagram(in, buffer + num_bytes, max_bytes - num_bytes, num_bytes);
+        if(nbytes < 0) {
+            return -1;
+        }
+    } else {
+        nbytes = read(fd, buffer + num_bytes, max_bytes - num_bytes);
+        if(nbytes < 0 && (errno == EINTR || errno == EAGAIN)) {
+            return 0;
+        }
+        if(nbytes < 0) {
+            printf("\nerror: could not read the input (%s)\n", strerror(errno));
+            in->error = true;
+            nbytes = 0;
+        }
+    }
+    in->end = nbytes == 0;
+    in->num_bytes += nbytes;
+    return nbytes;
+}
+
+// Reads up to max_bytes of a stream into buffer as the data arrives. Waits without a limit for the
+// first byte, then returns early with a partial packet once stream_flush_ms has passed.
+static size_t read_stream(struct data_input *in, unsigned char *buffer, size_t max_bytes) {
+    struct pollfd pfd = { .fd = fileno(in->fp), .events = POLLIN };
+    long long flush_time = 0;
+    size_t num_bytes = 0;
+    ssize_t nbytes;
+    int timeout_ms, ret;
+
+    while(num_bytes < max_bytes && running) {
+        timeout_ms = num_bytes == 0 ? STREAM_WAIT_MS : (int)(flush_time - monotonic_ms());
+        if(timeout_ms < 0) {
+            timeout_ms = 0;
+        }
+        ret = poll(&pfd, 1, timeout_ms);
+        if(ret < 0 && errno != EINTR) {
+            printf("error: poll on input failed\n");
+            exit(0);
+        }
+        if(ret == 0 && num_bytes > 0) {
+            break;      // Flush the partial packet
+        }
+        if(ret <= 0) {
+            continue;
+        }
+        nbytes = read_stream_data(in, buffer, num_bytes, max_bytes);
+        if(nbytes < 0 || in->end) {
+            break;      // The next datagram does not fit or the stream ended, send the partial packet
+        }
+        if(num_bytes == 0) {
+            flush_time = monotonic_ms() + stream_flush_ms;
+        }
+        num_bytes += nbytes;
+    }
+    if(!running) {
+        in->end = true;     // Interrupted, send what arrived as the last packet
+    }
+    return num_bytes;
+}
+
+// Returns true if fd is a datagram (UDP) socket, whose datagrams have to be read whole
+static bool is_datagram_socket(int fd) {
+    int type;
+    socklen_t len = sizeof(type);
+    return getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0 && type == SOCK_DGRAM;
+}
+
+// Sets up reading transmission data from fp in a mode. max_read_bytes is the most read_data_input is asked for
+// at once. Returns false if fp cannot be read in that mode, which only happens for compressed input that is not
+// a regular file or does not start with a gzip or zlib header.
+bool open_data_input(struct data_input *in, FILE *fp, enum input_mode mode, size_t max_read_bytes) {
+    in->mode = mode;
+    in->fp = fp;
+    in->size = get_file_size(fp);
+    in->end = false;
+    in->error = false;
+    in->num_bytes = 0;
+    in->datagram = is_datagram_socket(fileno(fp));
+    if(mode == INPUT_INFLATE) {
+        if(in->size < 0 || !is_compressed_file(fp)) {
+            printf("error: input is not a gzip or zlib compressed file\n");
+            return false;
+        }
+        printf("Input is compressed (%.2f MB), inflating it while transmitting\n", in->size / (1024.0 * 1024.0));
+        in->size = -1;      // Inflated size is not known up front
+        open_inflate_input(&in->inflate, fp);
+        return true;
+    }
+    if(in->size < 0) {
+        printf("Input is a stream, partial packets are sent after %d ms without new data\n", stream_flush_ms);
+        in->mode = INPUT_STREAM;
+    }
+    if(in->mode == INPUT_MMAP) {
+        open_mapped_input(&in->mapped, fp, in->size, max_read_bytes);
+    } else if(in->mode == INPUT_AIO) {
+        open_aio_input(&in->aio, fp, in->size);
+    }
+    return true;
+}
+
+// Reads up to max_bytes of transmission data, fewer only at the end of the input or when a stream
+// flushes a partial packet. Sets the end flag once the end of the input is reached, and the error flag as well
+// if reading fails, so the data read before the error is sent as the last packet. Sets data to point at the
+// bytes read. Stdio input copies them into buffer and sets window to NULL. Mapped and asynchronous input do not
+// copy and set window to the window or block the data is in, which has to be released once the data is no
+// longer needed.
+// Returns the number of bytes read.
+size_t read_data_input(struct data_input *in, unsigned char *buffer, size_t max_bytes,
+                       const unsigned char **data, struct input_window **window) {
+    size_t num_bytes;
+
+    *data = buffer;
+    *window = NULL;
+    if(in->mode == INPUT_STREAM) {
+        return read_stream(in, buffer, max_bytes);
+    }
+    if(in->mode == INPUT_MMAP) {
+        num_bytes = read_mapped_input(&in->mapped, max_bytes, data, window);
+    } else if(in->mode == INPUT_AIO) {
+        num_bytes = read_aio_input(&in->aio, buffer, max_bytes, data, window);
+        in->error = in->aio.error;
+    } else if(in->mode == INPUT_INFLATE) {
+        num_bytes = read_inflate_input(&in->inflate, buffer, max_bytes);
+        in->error = in->inflate.error;
+    } else {
+        num_bytes = fread(buffer, 1, max_bytes, in->fp);
+        if(num_bytes != max_bytes && ferror(in->fp)) {
+            printf("\nerror: could not read the input (%s)\n", strerror(errno));
+            in->error = true;
+        }
+    }
+    in->end = num_bytes != max_bytes;
+    in->num_bytes += num_bytes;
+    return num_bytes;
+}
+
+// Returns the file descriptor to poll for readable data, or -1 if the input is read ahead
+// (mapped or asynchronous) or compressed and is read whenever a packet is needed
+int get_data_input_poll_fd(const struct data_input *in) {
+    return in->mode == INPUT_STDIO || in->mode == INPUT_STREAM ? fileno(in->fp) : -1;
+}
+
+// Stops reading transmission data, the file itself is closed by the caller
+void close_data_input(struct data_input *in) {
+    if(in->mode == INPUT_MMAP) {
+        close_mapped_input(&in->mapped);
+    } else if(in->mode == INPUT_AIO) {
+        close_aio_input(&in->aio);
+    } else if(in->mode == INPUT_INFLATE) {
+        close_inflate_input(&in->inflate);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "mapped_input.h"
+#include "aio_input.h"
+#include "inflate_input.h"
+
+// Ways of reading transmission data
+enum input_mode {
+    INPUT_STDIO,        // Copied into packet buffers with fread
+    INPUT_MMAP,         // Modulated straight from mapped windows of the file
+    INPUT_AIO,          // Read ahead with a queue of asynchronous direct I/O reads
+    INPUT_STREAM,       // Pipes, FIFOs, sockets and other inputs of unknown length, read as data arrives
+    INPUT_INFLATE       // gzip or zlib compressed files, inflated as they are read (only when asked for with -z)
+};
+
+// Stream input configuration
+#define DEFAULT_STREAM_FLUSH_MS 100     // A partial packet is sent once its first data waited this long
+#define MAX_STREAM_FLUSH_MS 60000
+#define STREAM_WAIT_MS 100              // Longest wait for stream data before checking for ctrl + c
+
+// Transmission data being read
+struct data_input {
+    enum input_mode mode;
+    FILE *fp;
+    off_t size;                     // Size of the input in bytes for progress output, -1 for a stream
+                                    // or a compressed file
+    bool end;                       // End of the input was reached
+    bool error;                     // Reading failed, end is set as well so the frames sent so far are finished
+    bool datagram;                  // Input is a datagram (UDP) socket, datagrams are not split across packets
+    off_t num_bytes;                // Bytes read so far
+    struct mapped_input mapped;     // INPUT_MMAP only
+    struct aio_input aio;           // INPUT_AIO only
+    struct inflate_input inflate;   // INPUT_INFLATE only
+};
+
+// Function prototypes
+void set_stream_flush_ms(int flush_ms);
+int get_stream_flush_ms();
+long long monotonic_ms();
+bool open_data_input(struct data_input *in, FILE *fp, enum input_mode mode, size_t max_read_bytes);
+size_t read_data_input(struct data_input *in, unsigned char *buffer, size_t max_bytes,
+                       const unsigned char **data, struct input_window **window);
+ssize_t read_stream_data(struct data_input *in, unsigned char *buffer, size_t num_bytes, size_t max_bytes);
+int get_data_input_poll_fd(const struct data_input *in);
+void close_data_input(struct data_input *in);
+
+#endif /* INPUT_H */
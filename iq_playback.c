@@ -0,0 +1,121 @@
+/* Pre-modulated IQ file playback for MARLIN SDR */
+
+#include "transmitter.h"
+
+// Returns true if str ends with suffix
+static bool ends_with(const char *str, const char *suffix) {
+    size_t len = strlen(str), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+// Finds the value of a key in SigMF metadata. Returns a pointer to the first character of the value,
+// or NULL if the key is missing. The metadata is not parsed as a whole, keys are only looked for.
+static const char *find_sigmf_value(const char *meta, const char *key) {
+    char quoted[64];
+    const char *value;
+
+    snprintf(quoted, sizeof(quoted), "\"%s\"", key);
+    value = strstr(meta, quoted);
+    if(value == NULL || (value = strchr(value + strlen(quoted), ':')) == NULL) {
+        return NULL;
+    }
+    return value + 1 + strspn(value + 1, " \t\r\n");
+}
+
+// Checks the metadata of a SigMF dataset. Returns false if its samples cannot be played back unchanged.
+static bool check_sigmf_meta(const char *meta_path) {
+    char meta[MAX_SIGMF_META_BYTES];
+    const char *datatype, *sample_rate;
+    size_t num_bytes;
+    FILE *fp;
+
+    fp = fopen(meta_path, "rb");
+    if(fp == NULL) {
+        printf("\nCould not open SigMF metadata %s", meta_path);
+        return false;
+    }
+    num_bytes = fread(meta, 1, sizeof(meta) - 1, fp);
+    meta[num_bytes] = '\0';
+    fclose(fp);
+
+    datatype = find_sigmf_value(meta, "core:datatype");
+    if(datatype == NULL || strncmp(datatype, "\"" SIGMF_DATATYPE "\"", strlen(SIGMF_DATATYPE) + 2) != 0) {
+        printf("\nSigMF datatype must be %s, convert the recording first", SIGMF_DATATYPE);
+        return false;
+    }
+    sample_rate = find_sigmf_value(meta, "core:sample_rate");
+    if(sample_rate && llround(strtod(sample_rate, NULL)) != SAMPLE_RATE) {
+        printf("warning: recorded at %.0f samples/s but transmitted at %lld samples/s\n",
+               strtod(sample_rate, NULL), SAMPLE_RATE);
+    }
+    return true;
+}
+
+// Opens a pre-modulated IQ file. path is a raw IQ file, or a SigMF dataset given by its name or either of its
+// files, in which case the metadata is checked and the data file is opened. Returns NULL if it cannot be played.
+FILE *open_iq_file(const char *path) {
+    char meta_path[MAX_PATH_LENGTH + sizeof(SIGMF_META_SUFFIX)];
+    char data_path[MAX_PATH_LENGTH + sizeof(SIGMF_DATA_SUFFIX)];
+    size_t base_len = strlen(path);
+
+    if(ends_with(path, SIGMF_META_SUFFIX)) {
+        base_len -= strlen(SIGMF_META_SUFFIX);
+    } else if(ends_with(path, SIGMF_DATA_SUFFIX)) {
+        base_len -= strlen(SIGMF_DATA_SUFFIX);
+    }
+    snprintf(meta_path, sizeof(meta_path), "%.*s%s", (int)base_len, path, SIGMF_META_SUFFIX);
+    snprintf(data_path, sizeof(data_path), "%.*s%s", (int)base_len, path, SIGMF_DATA_SUFFIX);
+    if(access(meta_path, F_OK) != 0) {
+        return fopen(path, "rb");       // Raw IQ file
+    }
+    printf("SigMF dataset %s\n", data_path);
+    return check_sigmf_meta(meta_path) ? fopen(data_path, "rb") : NULL;
+}
+
+// Plays back a pre-modulated IQ file without modulating it. The file is mapped and each buffer is a
+// single copy from the page cache into tx_buf. The last one is short: it ends with the last sample, a partial
+// sample zero padded, and is zero padded only up to the DMA multiple (see pad_tx_buffer). Returns false if the file cannot
+// be played back or a push fails, true if all of it was sent or the playback was interrupted.
+bool play_iq_file(FILE *fp) {
+    size_t buffer_bytes = tx_buffer_samples() * IQ_SAMPLE_BYTES;
+    struct data_input input;
+    struct input_window *window;
+    const unsigned char *data;
+    size_t num_bytes, num_samples;
+    ssize_t nbytes_tx = 0;
+
+    if(get_file_size(fp) < 0) {
+        printf("error: IQ playback needs a regular file\n");
+        return false;
+    }
+    printf("\nBeginning IQ playback, press ctrl+c to stop\n\n");
+    open_data_input(&input, fp, INPUT_MMAP, buffer_bytes);
+    print_file_size(input.size);
+    if(input.size % IQ_SAMPLE_BYTES) {
+        printf("warning: file ends with a partial sample, it is zero padded\n");
+    }
+    printf("Transmitting...\n");
+
+    reset_push_stats();
+    while(running && !input.end) {
+        num_bytes = read_data_input(&input, NULL, buffer_bytes, &data, &window);
+        if(num_bytes == 0) {
+            break;
+        }
+        num_samples = (num_bytes + IQ_SAMPLE_BYTES - 1) / IQ_SAMPLE_BYTES;
+        memcpy(tx_buffer_first(), data, num_bytes);
+        memset((unsigned char *)tx_buffer_first() + num_bytes, 0, num_samples * IQ_SAMPLE_BYTES - num_bytes);
+        release_input_window(window);
+
+        nbytes_tx = push_tx_buffer_samples(pad_tx_buffer(num_samples));
+        if(nbytes_tx < 0) {
+            print_push_error(nbytes_tx);
+            break;
+        }
+        print_transmit_progress(input.num_bytes, input.size);
+    }
+    printf("\n");   // Needed since print_transmit_progress does not print a newline character
+    close_data_input(&input);
+    print_push_stats();
+    return nbytes_tx >= 0;
+}
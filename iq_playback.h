@@ -0,0 +1,18 @@
+#ifndef IQ_PLAYBACK_H
+#define IQ_PLAYBACK_H
+
+#include <stdio.h>
+
+// Pre-modulated IQ playback configuration. Samples are interleaved little endian int16 I and Q, the
+// memory layout of the packed 32-bit words the AD9361 takes, so files are copied into tx_buf unchanged.
+#define IQ_SAMPLE_BYTES 4
+#define SIGMF_META_SUFFIX ".sigmf-meta"
+#define SIGMF_DATA_SUFFIX ".sigmf-data"
+#define SIGMF_DATATYPE "ci16_le"            // The only SigMF datatype that needs no conversion
+#define MAX_SIGMF_META_BYTES (64 * 1024)    // Only the global object at the start is read
+
+// Function prototypes
+FILE *open_iq_file(const char *path);
+bool play_iq_file(FILE *fp);
+
+#endif /* IQ_PLAYBACK_H */
@@ -0,0 +1,111 @@
+/* Memory mapped, windowed file input for MARLIN SDR */
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "transmitter.h"
+
+// Maps the window of the input starting at the page containing read_offset, replacing the current window
+static void map_window(struct mapped_input *in) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    struct input_window *window = malloc(sizeof(*window));
+    void *base;
+
+    null_error_check((void *)window, "input window");
+    window->offset = in->read_offset - in->read_offset % page_size;
+    window->length = in->window_bytes;
+    if((off_t)window->length > in->file_size - window->offset) {
+        window->length = in->file_size - window->offset;
+    }
+    window->refs = 1;   // Held by the reader
+    window->aio_block = false;
+    base = mmap(NULL, window->length, PROT_READ, MAP_SHARED, in->fd, window->offset);
+    if(base == MAP_FAILED) {
+        printf("error: could not map input file at offset %lld\n", (long long)window->offset);
+        exit(0);
+    }
+    window->base = base;
+    madvise(window->base, window->length, MADV_SEQUENTIAL);
+
+    if(in->window) {
+        release_input_window(in->window);
+    }
+    in->window = window;
+    in->advised_offset = in->read_offset;
+}
+
+// Asks the kernel to read the next MAP_READAHEAD_BYTES of the current window into the page cache,
+// so that the modulator does not wait on page faults
+static void advise_readahead(struct mapped_input *in) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    off_t window_end = in->window->offset + in->window->length;
+    off_t start, end;
+
+    if(in->advised_offset >= in->read_offset + MAP_READAHEAD_BYTES / 2) {
+        return;     // Enough requested already
+    }
+    start = in->advised_offset - in->advised_offset % page_size;
+    end = in->read_offset + MAP_READAHEAD_BYTES;
+    if(end > window_end) {
+        end = window_end;
+    }
+    if(end > start) {
+        madvise(in->window->base + (start - in->window->offset), end - start, MADV_WILLNEED);
+        in->advised_offset = end;
+    }
+}
+
+// Sets up reading fp through mapped windows. max_read_bytes is the most read_mapped_input is asked for at once.
+void open_mapped_input(struct mapped_input *in, FILE *fp, off_t file_size, size_t max_read_bytes) {
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    in->fd = fileno(fp);
+    in->file_size = file_size;
+    in->read_offset = 0;
+    in->advised_offset = 0;
+    in->window = NULL;
+    in->window_bytes = MAP_WINDOW_BYTES;
+    if(in->window_bytes < max_read_bytes + page_size) {
+        in->window_bytes = max_read_bytes + page_size;  // A read always fits in one window
+    }
+}
+
+// Hands out the next max_bytes of the file, or fewer at the end of the file, without copying. Sets data
+// to point at them inside a mapped window and window to that window, which the caller has to release
+// with release_input_window once it is done with the data. Returns the number of bytes handed out.
+size_t read_mapped_input(struct mapped_input *in, size_t max_bytes, const unsigned char **data,
+                         struct input_window **window) {
+    size_t num_bytes = max_bytes;
+
+    if((off_t)num_bytes > in->file_size - in->read_offset) {
+        num_bytes = in->file_size - in->read_offset;
+    }
+    if(in->window == NULL || in->read_offset + (off_t)num_bytes > in->window->offset + (off_t)in->window->length) {
+        if(num_bytes == 0) {
+            *data = NULL;
+            *window = NULL;
+            return 0;
+        }
+        map_window(in);
+    }
+    advise_readahead(in);
+
+    *data = in->window->base + (in->read_offset - in->window->offset);
+    *window = in->window;
+    __atomic_add_fetch(&in->window->refs, 1, __ATOMIC_RELAXED);
+    in->read_offset += num_bytes;
+    return num_bytes;
+}
+
+// Drops a reference to a window, unmapping it once nothing uses it anymore
+void release_input_window(struct input_window *window) {
+    if(window && __atomic_sub_fetch(&window->refs, 1, __ATOMIC_ACQ_REL) == 0 && !window->aio_block) {
+        munmap(window->base, window->length);
+        free(window);
+    }
+}
+
+// Releases the current window of the reader. Windows still used by packets are unmapped when they are released.
+void close_mapped_input(struct mapped_input *in) {
+    release_input_window(in->window);
+    in->window = NULL;
+}
@@ -0,0 +1,42 @@
+#ifndef MAPPED_INPUT_H
+#define MAPPED_INPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Memory mapped input configuration. The file is mapped in windows so that files larger than the
+// 32-bit address space can be transmitted, and pages are read ahead of the modulator with madvise.
+#define MAP_WINDOW_BYTES (32 * 1024 * 1024)     // Mapped at a time (grown to fit the largest read)
+#define MAP_READAHEAD_BYTES (4 * 1024 * 1024)   // Requested ahead of the data handed out
+
+// A mapped window of the input file. Shared by the reader and every packet pointing into it,
+// and unmapped when the last of them releases it.
+struct input_window {
+    unsigned char *base;        // Page aligned start of the mapping
+    size_t length;
+    off_t offset;               // File offset of base
+    int refs;
+    bool aio_block;             // Block of asynchronous input (see aio_input.h), which is not unmapped but
+                                // read into again once no packet holds it
+};
+
+// A file read through windows mapped straight from the page cache
+struct mapped_input {
+    int fd;
+    off_t file_size;
+    off_t read_offset;          // Next byte handed out
+    off_t advised_offset;       // Readahead requested up to here
+    size_t window_bytes;
+    struct input_window *window;    // Window containing read_offset, held by the reader
+};
+
+// Function prototypes
+void open_mapped_input(struct mapped_input *in, FILE *fp, off_t file_size, size_t max_read_bytes);
+size_t read_mapped_input(struct mapped_input *in, size_t max_bytes, const unsigned char **data,
+                         struct input_window **window);
+void release_input_window(struct input_window *window);
+void close_mapped_input(struct mapped_input *in);
+
+#endif /* MAPPED_INPUT_H */
@@ -0,0 +1,552 @@
+/* Modulation for MARLIN SDR */
+
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "modulation.h"
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#define VERIFY_BYTES (256 + 27)     // Amount of bytes checked by verify_constellations
+
+// APSK ring configuration (DVB-S2 style ring sizes and radius ratios)
+#define APSK_16_RING_RATIO 2.85
+#define APSK_32_RING_RATIO_1 2.84
+#define APSK_32_RING_RATIO_2 5.27
+
+// PRBS generator polynomials (ITU-T O.150), x^order + x^tap + 1
+static const int prbs_order[NUM_TEST_PATTERNS] = { 0, 0, 7, 9, 15 };
+static const int prbs_tap[NUM_TEST_PATTERNS] = { 0, 0, 6, 5, 14 };
+
+// All supported constellations, indexed by modulation ID
+static struct constellation constellations[NUM_MODULATIONS];
+
+// Takes in a bitpair and set the corresponding i and q values.
+void qpsk_modulation(int bitpair, int16_t *i, int16_t *q) {
+    switch(bitpair) {
+        case 0x00:
+            *i = QPSK_00_I;
+            *q = QPSK_00_Q;
+            break;
+        case 0x01:
+            *i = QPSK_01_I;
+            *q = QPSK_01_Q;
+            break;
+        case 0x02:
+            *i = QPSK_10_I;
+            *q = QPSK_10_Q;
+            break;
+        case 0x03:
+            *i = QPSK_11_I;
+            *q = QPSK_11_Q;
+            break;
+    }
+}
+
+// Takes in a fourbit and sets corresponding i and q values.
+void sxtn_qam_modulation(int fourbit, int16_t *i, int16_t *q) {
+    switch(fourbit) {
+        case 0x00:
+            *i = SXTN_QAM_0000_I;
+            *q = SXTN_QAM_0000_Q;
+            break;
+        case 0x01:
+            *i = SXTN_QAM_0001_I;
+            *q = SXTN_QAM_0001_Q;
+            break;
+        case 0x02:
+            *i = SXTN_QAM_0010_I;
+            *q = SXTN_QAM_0010_Q;
+            break;
+        case 0x03:
+            *i = SXTN_QAM_0011_I;
+            *q = SXTN_QAM_0011_Q;
+            break;
+        case 0x04:
+            *i = SXTN_QAM_0100_I;
+            *q = SXTN_QAM_0100_Q;
+            break;
+        case 0x05:
+            *i = SXTN_QAM_0101_I;
+            *q = SXTN_QAM_0101_Q;
+            break;
+        case 0x06:
+            *i = SXTN_QAM_0110_I;
+            *q = SXTN_QAM_0110_Q;
+            break;
+        case 0x07:
+            *i = SXTN_QAM_0111_I;
+            *q = SXTN_QAM_0111_Q;
+            break;
+        case 0x08:
+            *i = SXTN_QAM_1000_I;
+            *q = SXTN_QAM_1000_Q;
+            break;
+        case 0x09:
+            *i = SXTN_QAM_1001_I;
+            *q = SXTN_QAM_1001_Q;
+            break;
+        case 0x0a:
+            *i = SXTN_QAM_1010_I;
+            *q = SXTN_QAM_1010_Q;
+            break;
+        case 0x0b:
+            *i = SXTN_QAM_1011_I;
+            *q = SXTN_QAM_1011_Q;
+            break;
+        case 0x0c:
+            *i = SXTN_QAM_1100_I;
+            *q = SXTN_QAM_1100_Q;
+            break;
+        case 0x0d:
+            *i = SXTN_QAM_1101_I;
+            *q = SXTN_QAM_1101_Q;
+            break;
+        case 0x0e:
+            *i = SXTN_QAM_1110_I;
+            *q = SXTN_QAM_1110_Q;
+            break;
+        case 0x0f:
+            *i = SXTN_QAM_1111_I;
+            *q = SXTN_QAM_1111_Q;
+            break;
+    }
+}
+
+// Returns the position of a Gray coded value in its Gray code sequence
+static int gray_decode(int value) {
+    int position = 0;
+    for(; value; value >>= 1) {
+        position ^= value;
+    }
+    return position;
+}
+
+// Sets up a PSK constellation with Gray labelled points evenly spaced around a circle
+static void set_up_psk(struct constellation *c, double radius, double phase) {
+    for(int symbol = 0; symbol < c->num_points; symbol++) {
+        double angle = phase + 2 * M_PI * gray_decode(symbol) / c->num_points;
+        c->i[symbol] = (int16_t)lround(radius * cos(angle));
+        c->q[symbol] = (int16_t)lround(radius * sin(angle));
+    }
+}
+
+// Sets up a square QAM constellation. The high half of each symbol selects the row (Q) and the low half
+// selects the column (I), both Gray coded, the same layout as the 16QAM mapping in modulation.h.
+static void set_up_square_qam(struct constellation *c) {
+    int half_bits = c->bits_per_symbol / 2;
+    int levels = 1 << half_bits;
+    int16_t step = CONSTELLATION_AMPLITUDE / (levels - 1);
+    for(int symbol = 0; symbol < c->num_points; symbol++) {
+        int row = gray_decode(symbol >> half_bits);
+        int column = gray_decode(symbol & (levels - 1));
+        c->i[symbol] = (int16_t)((2 * column - (levels - 1)) * step);
+        c->q[symbol] = (int16_t)(((levels - 1) - 2 * row) * step);
+    }
+}
+
+// Sets up an APSK constellation from concentric rings. Symbols fill the rings from the inside out,
+// and points are Gray labelled by angle within each ring.
+static void set_up_apsk(struct constellation *c, const int *ring_points, const double *ring_radius, int num_rings) {
+    int symbol = 0;
+    double outer_radius = CONSTELLATION_AMPLITUDE * M_SQRT2;
+    for(int ring = 0; ring < num_rings; ring++) {
+        double radius = outer_radius * ring_radius[ring] / ring_radius[num_rings - 1];
+        for(int point = 0; point < ring_points[ring]; point++, symbol++) {
+            double angle = M_PI / ring_points[ring] + 2 * M_PI * gray_decode(point) / ring_points[ring];
+            c->i[symbol] = (int16_t)lround(radius * cos(angle));
+            c->q[symbol] = (int16_t)lround(radius * sin(angle));
+        }
+    }
+}
+
+// Maps bytes one symbol at a time by walking the bits. Slow, but independent of the specialized
+// mappers, so it is used as the reference when verifying them.
+static size_t map_bytes_reference(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    size_t num_symbols = constellation_symbols(c, num_bytes);
+    for(size_t n = 0; n < num_symbols; n++) {
+        int symbol = 0;
+        for(int bit_num = 0; bit_num < c->bits_per_symbol; bit_num++) {
+            size_t bit = n * c->bits_per_symbol + bit_num;
+            int value = (bit < num_bytes * 8) ? (data[bit / 8] >> (7 - bit % 8)) & 1 : 0;
+            symbol = (symbol << 1) | value;
+        }
+        iq[n] = PACK_IQ(c->i[symbol], c->q[symbol]);
+    }
+    return num_symbols;
+}
+
+#ifdef __ARM_NEON
+// NEON kernel for orders that divide 8 and have at most 16 points (BPSK, QPSK, 16QAM). Each block of
+// 8 * bits_per_symbol bytes is unpacked into 64 samples, eight at a time: every byte is duplicated into
+// 8 / bits_per_symbol lanes, shifted so each lane holds one symbol, and the I and Q values are looked up
+// with vtbl and stored interleaved with vst2.
+static inline void map_blocks_neon(const struct constellation *c, const unsigned char *data, size_t num_blocks, uint32_t *iq, const int bits_per_symbol) {
+    const int symbols_per_byte = 8 / bits_per_symbol;
+    uint8_t byte_index[8];
+    int8_t symbol_shift[8];
+    for(int lane = 0; lane < 8; lane++) {
+        byte_index[lane] = lane / symbols_per_byte;
+        symbol_shift[lane] = -(8 - bits_per_symbol * (lane % symbols_per_byte + 1));
+    }
+    const uint8x8x2_t i_lo = {{ vld1_u8(&c->symbol_bytes[0][0]), vld1_u8(&c->symbol_bytes[0][8]) }};
+    const uint8x8x2_t i_hi = {{ vld1_u8(&c->symbol_bytes[1][0]), vld1_u8(&c->symbol_bytes[1][8]) }};
+    const uint8x8x2_t q_lo = {{ vld1_u8(&c->symbol_bytes[2][0]), vld1_u8(&c->symbol_bytes[2][8]) }};
+    const uint8x8x2_t q_hi = {{ vld1_u8(&c->symbol_bytes[3][0]), vld1_u8(&c->symbol_bytes[3][8]) }};
+    const int8x8_t shift = vld1_s8(symbol_shift);
+    const uint8x8_t mask = vdup_n_u8((1 << bits_per_symbol) - 1);
+    const uint8x8_t next_bytes = vdup_n_u8(bits_per_symbol);
+
+    for(size_t block = 0; block < num_blocks; block++, data += 8 * bits_per_symbol, iq += 64) {
+        uint8x8x4_t block_bytes;
+        if(bits_per_symbol == 1) {
+            block_bytes.val[0] = vld1_u8(data);
+        } else {
+            uint8x16_t bytes = vld1q_u8(data);
+            block_bytes.val[0] = vget_low_u8(bytes);
+            block_bytes.val[1] = vget_high_u8(bytes);
+            if(bits_per_symbol == 4) {
+                bytes = vld1q_u8(data + 16);
+                block_bytes.val[2] = vget_low_u8(bytes);
+                block_bytes.val[3] = vget_high_u8(bytes);
+            }
+        }
+        uint8x8_t index = vld1_u8(byte_index);
+        for(int n = 0; n < 8; n++, index = vadd_u8(index, next_bytes)) {
+            uint8x8_t source, symbols, i_lo_bytes, i_hi_bytes, q_lo_bytes, q_hi_bytes;
+            if(bits_per_symbol == 1) {
+                source = vtbl1_u8(block_bytes.val[0], index);
+            } else if(bits_per_symbol == 2) {
+                source = vtbl2_u8((uint8x8x2_t){{ block_bytes.val[0], block_bytes.val[1] }}, index);
+            } else {
+                source = vtbl4_u8(block_bytes, index);
+            }
+            symbols = vand_u8(vshl_u8(source, shift), mask);
+            if(bits_per_symbol == 4) {
+                i_lo_bytes = vtbl2_u8(i_lo, symbols);
+                i_hi_bytes = vtbl2_u8(i_hi, symbols);
+                q_lo_bytes = vtbl2_u8(q_lo, symbols);
+                q_hi_bytes = vtbl2_u8(q_hi, symbols);
+            } else {
+                i_lo_bytes = vtbl1_u8(i_lo.val[0], symbols);
+                i_hi_bytes = vtbl1_u8(i_hi.val[0], symbols);
+                q_lo_bytes = vtbl1_u8(q_lo.val[0], symbols);
+                q_hi_bytes = vtbl1_u8(q_hi.val[0], symbols);
+            }
+            uint8x8x2_t i = vzip_u8(i_lo_bytes, i_hi_bytes);
+            uint8x8x2_t q = vzip_u8(q_lo_bytes, q_hi_bytes);
+            int16x8x2_t samples;
+            samples.val[0] = vreinterpretq_s16_u8(vcombine_u8(i.val[0], i.val[1]));
+            samples.val[1] = vreinterpretq_s16_u8(vcombine_u8(q.val[0], q.val[1]));
+            vst2q_s16((int16_t *)(iq + n * 8), samples);
+        }
+    }
+}
+#endif
+
+// Inner loop for orders that divide 8 (BPSK, QPSK, 16QAM). One byte table lookup gives all of the byte's
+// samples. Inlined with a constant bits_per_symbol so the per byte copy is fully unrolled.
+static inline size_t map_bytes_table(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq, const int bits_per_symbol) {
+    const int symbols_per_byte = 8 / bits_per_symbol;
+    size_t num_symbols = num_bytes * symbols_per_byte;
+#ifdef __ARM_NEON
+    size_t num_blocks = num_bytes / (8 * bits_per_symbol);
+    map_blocks_neon(c, data, num_blocks, iq, bits_per_symbol);
+    data += num_blocks * 8 * bits_per_symbol;
+    iq += num_blocks * 64;
+    num_bytes -= num_blocks * 8 * bits_per_symbol;
+#endif
+    for(size_t n = 0; n < num_bytes; n++, iq += symbols_per_byte) {
+        const uint32_t *samples = c->byte_table[data[n]];
+        for(int symbol_num = 0; symbol_num < symbols_per_byte; symbol_num++) {
+            iq[symbol_num] = samples[symbol_num];
+        }
+    }
+    return num_symbols;
+}
+
+// Inner loop for orders that do not divide 8 (8PSK, 32APSK, 64QAM). Every bits_per_symbol bytes are
+// loaded into one word and split into 8 symbols. A final partial group is padded with zero bits.
+// Inlined with a constant bits_per_symbol so the shifts are fully unrolled.
+static inline size_t map_bytes_groups(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq, const int bits_per_symbol) {
+    const uint64_t mask = (1 << bits_per_symbol) - 1;
+    size_t num_symbols = constellation_symbols(c, num_bytes);
+    size_t num_groups = num_bytes / bits_per_symbol;
+    unsigned char last_group[MAX_BITS_PER_SYMBOL] = { 0 };
+    uint32_t last_samples[GROUP_SYMBOLS];
+
+    for(size_t group = 0; group <= num_groups; group++, data += bits_per_symbol, iq += GROUP_SYMBOLS) {
+        const unsigned char *group_data = data;
+        uint32_t *group_iq = iq;
+        uint64_t bits = 0;
+
+        // Partial group at the end of the data
+        if(group == num_groups) {
+            size_t remaining_bytes = num_bytes - num_groups * bits_per_symbol;
+            if(remaining_bytes == 0) {
+                break;
+            }
+            memcpy(last_group, data, remaining_bytes);
+            group_data = last_group;
+            group_iq = last_samples;
+        }
+
+        for(int byte_num = 0; byte_num < bits_per_symbol; byte_num++) {
+            bits = (bits << 8) | group_data[byte_num];
+        }
+        for(int symbol_num = 0; symbol_num < GROUP_SYMBOLS; symbol_num++) {
+            group_iq[symbol_num] = c->symbol_table[(bits >> ((GROUP_SYMBOLS - 1 - symbol_num) * bits_per_symbol)) & mask];
+        }
+        if(group_iq == last_samples) {
+            memcpy(iq, last_samples, (num_symbols - num_groups * GROUP_SYMBOLS) * sizeof(uint32_t));
+        }
+    }
+    return num_symbols;
+}
+
+// Inner loop for 256-point constellations, one symbol per byte
+static size_t map_bytes_bps8(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    for(size_t n = 0; n < num_bytes; n++) {
+        iq[n] = c->symbol_table[data[n]];
+    }
+    return num_bytes;
+}
+
+// Specialized mappers, one per modulation order
+static size_t map_bytes_bps1(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    return map_bytes_table(c, data, num_bytes, iq, 1);
+}
+
+static size_t map_bytes_bps2(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    return map_bytes_table(c, data, num_bytes, iq, 2);
+}
+
+static size_t map_bytes_bps3(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    return map_bytes_groups(c, data, num_bytes, iq, 3);
+}
+
+static size_t map_bytes_bps4(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    return map_bytes_table(c, data, num_bytes, iq, 4);
+}
+
+static size_t map_bytes_bps5(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    return map_bytes_groups(c, data, num_bytes, iq, 5);
+}
+
+static size_t map_bytes_bps6(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    return map_bytes_groups(c, data, num_bytes, iq, 6);
+}
+
+// Fills in the lookup tables of a constellation from its I and Q values and selects its inner loop
+static void set_up_constellation_tables(struct constellation *c) {
+    static size_t (*const mappers[MAX_BITS_PER_SYMBOL + 1])(const struct constellation *, const unsigned char *, size_t, uint32_t *) = {
+        NULL, map_bytes_bps1, map_bytes_bps2, map_bytes_bps3, map_bytes_bps4,
+        map_bytes_bps5, map_bytes_bps6, NULL, map_bytes_bps8
+    };
+    int bits_per_symbol = c->bits_per_symbol;
+
+    for(int symbol = 0; symbol < c->num_points; symbol++) {
+        c->symbol_table[symbol] = PACK_IQ(c->i[symbol], c->q[symbol]);
+        if(symbol < 16) {
+            c->symbol_bytes[0][symbol] = (uint16_t)c->i[symbol] & 0xFF;
+            c->symbol_bytes[1][symbol] = (uint16_t)c->i[symbol] >> 8;
+            c->symbol_bytes[2][symbol] = (uint16_t)c->q[symbol] & 0xFF;
+            c->symbol_bytes[3][symbol] = (uint16_t)c->q[symbol] >> 8;
+        }
+    }
+    if(8 % bits_per_symbol == 0) {
+        for(int byte = 0; byte < 256; byte++) {
+            for(int symbol_num = 0; symbol_num < 8 / bits_per_symbol; symbol_num++) {
+                int symbol = (byte >> (8 - bits_per_symbol * (symbol_num + 1))) & (c->num_points - 1);
+                c->byte_table[byte][symbol_num] = c->symbol_table[symbol];
+            }
+        }
+    }
+    c->map_bytes = mappers[bits_per_symbol];
+}
+
+// Sets up all supported constellations. QPSK and 16QAM are built from the per symbol modulation
+// functions so their output stays bit exact with the original mappings.
+void set_up_constellations() {
+    static const char *names[NUM_MODULATIONS] = { "BPSK", "QPSK", "8PSK", "16QAM", "64QAM", "256QAM", "16APSK", "32APSK" };
+    static const int bits_per_symbol[NUM_MODULATIONS] = { 1, 2, 3, 4, 6, 8, 4, 5 };
+    static const int apsk_16_ring_points[2] = { 4, 12 };
+    static const double apsk_16_ring_radius[2] = { 1.0, APSK_16_RING_RATIO };
+    static const int apsk_32_ring_points[3] = { 4, 12, 16 };
+    static const double apsk_32_ring_radius[3] = { 1.0, APSK_32_RING_RATIO_1, APSK_32_RING_RATIO_2 };
+
+    for(int id = 0; id < NUM_MODULATIONS; id++) {
+        struct constellation *c = &constellations[id];
+        memset(c, 0, sizeof(*c));
+        c->id = id;
+        c->name = names[id];
+        c->bits_per_symbol = bits_per_symbol[id];
+        c->num_points = 1 << c->bits_per_symbol;
+
+        switch(id) {
+            case MOD_BPSK:
+                set_up_psk(c, CONSTELLATION_AMPLITUDE, 0);
+                break;
+            case MOD_QPSK:
+                for(int bitpair = 0; bitpair < c->num_points; bitpair++) {
+                    qpsk_modulation(bitpair, &c->i[bitpair], &c->q[bitpair]);
+                }
+                break;
+            case MOD_8PSK:
+                set_up_psk(c, CONSTELLATION_AMPLITUDE * M_SQRT2, 0);
+                break;
+            case MOD_16QAM:
+                for(int fourbit = 0; fourbit < c->num_points; fourbit++) {
+                    sxtn_qam_modulation(fourbit, &c->i[fourbit], &c->q[fourbit]);
+                }
+                break;
+            case MOD_64QAM:
+            case MOD_256QAM:
+                set_up_square_qam(c);
+                break;
+            case MOD_16APSK:
+                set_up_apsk(c, apsk_16_ring_points, apsk_16_ring_radius, 2);
+                break;
+            case MOD_32APSK:
+                set_up_apsk(c, apsk_32_ring_points, apsk_32_ring_radius, 3);
+                break;
+        }
+        set_up_constellation_tables(c);
+    }
+}
+
+// Compares the specialized mapper of every constellation against the bit by bit reference mapper,
+// and the QPSK and 16QAM points against the per symbol switch based modulation. Returns the number of
+// samples that differ, so 0 means the output is bit exact. The length is not a multiple of any group or
+// NEON block size so both the unrolled body and the tail handling are checked.
+int verify_constellations() {
+    unsigned char data[VERIFY_BYTES];
+    uint32_t mapped[VERIFY_BYTES * 8];
+    uint32_t reference[VERIFY_BYTES * 8];
+    int16_t i, q;
+    int mismatches = 0;
+
+    for(int byte = 0; byte < VERIFY_BYTES; byte++) {
+        data[byte] = byte & 0xFF;
+    }
+
+    for(int id = 0; id < NUM_MODULATIONS; id++) {
+        const struct constellation *c = &constellations[id];
+        size_t num_mapped = map_bytes(c, data, VERIFY_BYTES, mapped);
+        size_t num_reference = map_bytes_reference(c, data, VERIFY_BYTES, reference);
+        if(num_mapped != num_reference) {
+            return -1;
+        }
+        for(size_t n = 0; n < num_mapped; n++) {
+            mismatches += mapped[n] != reference[n];
+        }
+    }
+
+    for(int bitpair = 0; bitpair < 4; bitpair++) {
+        qpsk_modulation(bitpair, &i, &q);
+        mismatches += constellations[MOD_QPSK].symbol_table[bitpair] != PACK_IQ(i, q);
+    }
+    for(int fourbit = 0; fourbit < 16; fourbit++) {
+        sxtn_qam_modulation(fourbit, &i, &q);
+        mismatches += constellations[MOD_16QAM].symbol_table[fourbit] != PACK_IQ(i, q);
+    }
+
+    return mismatches;
+}
+
+// Returns the constellation of a modulation
+const struct constellation *get_constellation(enum modulation_id id) {
+    return &constellations[id];
+}
+
+// Returns the constellation with the given name (case insensitive), or NULL if there is none
+const struct constellation *find_constellation(const char *name) {
+    for(int id = 0; id < NUM_MODULATIONS; id++) {
+        if(strcasecmp(constellations[id].name, name) == 0) {
+            return &constellations[id];
+        }
+    }
+    return NULL;
+}
+
+// Returns the number of samples num_bytes of data are mapped to (a partial last symbol is zero padded)
+size_t constellation_symbols(const struct constellation *c, size_t num_bytes) {
+    return (num_bytes * 8 + c->bits_per_symbol - 1) / c->bits_per_symbol;
+}
+
+// Returns the number of whole bytes that fit in num_symbols samples without splitting a group of 8 symbols
+size_t constellation_bytes(const struct constellation *c, size_t num_symbols) {
+    return (num_symbols / GROUP_SYMBOLS) * c->bits_per_symbol;
+}
+
+// Modulates bytes, writing packed IQ samples. Returns the number of samples written.
+size_t map_bytes(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq) {
+    return c->map_bytes(c, data, num_bytes, iq);
+}
+
+// Returns the name of a test pattern
+const char *test_pattern_name(enum test_pattern pattern) {
+    static const char *names[NUM_TEST_PATTERNS] = { "single symbol", "symbol cycle", "PRBS7", "PRBS9", "PRBS15" };
+    return names[pattern];
+}
+
+// Returns the next bit of a PRBS sequence and advances the LFSR state
+static int prbs_next_bit(uint32_t *state, int order, int tap) {
+    int bit = ((*state >> (order - 1)) ^ (*state >> (tap - 1))) & 1;
+    *state = ((*state << 1) | bit) & ((1u << order) - 1);
+    return bit;
+}
+
+// Returns the number of samples in one period of a test pattern. PRBS patterns take bits_per_symbol
+// periods of the sequence, which is a whole number of symbols, so the pattern repeats seamlessly
+// when it is replayed by a cyclic buffer.
+static size_t test_pattern_period(const struct constellation *c, enum test_pattern pattern) {
+    switch(pattern) {
+        case PATTERN_SINGLE_SYMBOL:
+            return 1;
+        case PATTERN_SYMBOL_CYCLE:
+            return (size_t)c->num_points * TEST_SYMBOL_HOLD_SAMPLES;
+        default:
+            return (1u << prbs_order[pattern]) - 1;
+    }
+}
+
+// Returns the number of samples of a test pattern, a whole number of periods that is at least
+// TEST_MIN_PATTERN_SAMPLES long
+size_t test_pattern_samples(const struct constellation *c, enum test_pattern pattern) {
+    size_t period = test_pattern_period(c, pattern);
+    return ((TEST_MIN_PATTERN_SAMPLES + period - 1) / period) * period;
+}
+
+// Writes a test pattern of test_pattern_samples samples. symbol is only used by the single symbol pattern.
+void build_test_pattern(const struct constellation *c, enum test_pattern pattern, int symbol, uint32_t *iq) {
+    size_t period = test_pattern_period(c, pattern);
+    size_t num_samples = test_pattern_samples(c, pattern);
+    uint32_t state = (pattern >= PATTERN_PRBS7) ? (1u << prbs_order[pattern]) - 1 : 0;    // All ones seed
+
+    // Build the first period
+    for(size_t n = 0; n < period; n++) {
+        switch(pattern) {
+            case PATTERN_SINGLE_SYMBOL:
+                iq[n] = c->symbol_table[symbol];
+                break;
+            case PATTERN_SYMBOL_CYCLE:
+                iq[n] = c->symbol_table[n / TEST_SYMBOL_HOLD_SAMPLES];
+                break;
+            default:
+                symbol = 0;
+                for(int bit_num = 0; bit_num < c->bits_per_symbol; bit_num++) {
+                    symbol = (symbol << 1) | prbs_next_bit(&state, prbs_order[pattern], prbs_tap[pattern]);
+                }
+                iq[n] = c->symbol_table[symbol];
+                break;
+        }
+    }
+
+    // Repeat it for the rest of the pattern
+    for(size_t n = period; n < num_samples; n += period) {
+        memcpy(iq + n, iq, period * sizeof(uint32_t));
+    }
+}
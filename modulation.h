@@ -0,0 +1,134 @@
+#ifndef MODULATION_H
+#define MODULATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// QPSK values
+#define QPSK_NEG (int16_t)-23152
+#define QPSK_POS (int16_t)23152
+#define QPSK_00_I QPSK_POS
+#define QPSK_00_Q QPSK_POS
+#define QPSK_01_I QPSK_POS
+#define QPSK_01_Q QPSK_NEG
+#define QPSK_10_I QPSK_NEG
+#define QPSK_10_Q QPSK_POS
+#define QPSK_11_I QPSK_NEG
+#define QPSK_11_Q QPSK_NEG
+
+// 16QAM values
+// Mapping is as follows:
+//   (-3, 3)   (-1, 3)   (1, 3)    (3, 3)
+//     0000     0001      0011      0010
+
+//   (-3, 1)   (-1, 1)   (1, 1)    (3, 1)
+//     0100     0101      0111      0110
+
+//   (-3, -1)  (-1, -1)  (1, -1)   (3, -1)
+//     1100     1101      1111      1110
+
+//   (-3, -3)  (-1, -3)  (1, -3)   (3, -3)
+//     1000     1001      1011      1010
+#define SXTN_QAM_NEG_ONE    (int16_t)-7717      // -(23152/3)
+#define SXTN_QAM_POS_ONE    (int16_t)7717       // (23152/3)
+#define SXTN_QAM_NEG_THREE  (int16_t)-23151
+#define SXTN_QAM_POS_THREE  (int16_t)23151
+#define SXTN_QAM_0000_I SXTN_QAM_NEG_THREE
+#define SXTN_QAM_0000_Q SXTN_QAM_POS_THREE
+#define SXTN_QAM_0001_I SXTN_QAM_NEG_ONE
+#define SXTN_QAM_0001_Q SXTN_QAM_POS_THREE
+#define SXTN_QAM_0010_I SXTN_QAM_POS_THREE
+#define SXTN_QAM_0010_Q SXTN_QAM_POS_THREE
+#define SXTN_QAM_0011_I SXTN_QAM_POS_ONE
+#define SXTN_QAM_0011_Q SXTN_QAM_POS_THREE
+#define SXTN_QAM_0100_I SXTN_QAM_NEG_THREE
+#define SXTN_QAM_0100_Q SXTN_QAM_POS_ONE
+#define SXTN_QAM_0101_I SXTN_QAM_NEG_ONE
+#define SXTN_QAM_0101_Q SXTN_QAM_POS_ONE
+#define SXTN_QAM_0110_I SXTN_QAM_POS_THREE
+#define SXTN_QAM_0110_Q SXTN_QAM_POS_ONE
+#define SXTN_QAM_0111_I SXTN_QAM_POS_ONE
+#define SXTN_QAM_0111_Q SXTN_QAM_POS_ONE
+#define SXTN_QAM_1000_I SXTN_QAM_NEG_THREE
+#define SXTN_QAM_1000_Q SXTN_QAM_NEG_THREE
+#define SXTN_QAM_1001_I SXTN_QAM_NEG_ONE
+#define SXTN_QAM_1001_Q SXTN_QAM_NEG_THREE
+#define SXTN_QAM_1010_I SXTN_QAM_POS_THREE
+#define SXTN_QAM_1010_Q SXTN_QAM_NEG_THREE
+#define SXTN_QAM_1011_I SXTN_QAM_POS_ONE
+#define SXTN_QAM_1011_Q SXTN_QAM_NEG_THREE
+#define SXTN_QAM_1100_I SXTN_QAM_NEG_THREE
+#define SXTN_QAM_1100_Q SXTN_QAM_NEG_ONE
+#define SXTN_QAM_1101_I SXTN_QAM_NEG_ONE
+#define SXTN_QAM_1101_Q SXTN_QAM_NEG_ONE
+#define SXTN_QAM_1110_I SXTN_QAM_POS_THREE
+#define SXTN_QAM_1110_Q SXTN_QAM_NEG_ONE
+#define SXTN_QAM_1111_I SXTN_QAM_POS_ONE
+#define SXTN_QAM_1111_Q SXTN_QAM_NEG_ONE
+
+// Constellation engine configuration
+#define MAX_BITS_PER_SYMBOL 8
+#define MAX_CONSTELLATION_POINTS (1 << MAX_BITS_PER_SYMBOL)
+#define GROUP_SYMBOLS 8                 // bits_per_symbol bytes of data always hold exactly 8 symbols
+#define CONSTELLATION_AMPLITUDE 23152   // Largest I or Q value of the square constellations (same as QPSK)
+
+// Packs an i and q value into a 32-bit word laid out as one complex sample in tx_buf
+// (16 bit I followed by 16 bit Q, little endian like the Zynq and x86 hosts)
+#define PACK_IQ(i, q) ((uint32_t)(uint16_t)(i) | ((uint32_t)(uint16_t)(q) << 16))
+
+// Supported modulations
+enum modulation_id {
+    MOD_BPSK,
+    MOD_QPSK,
+    MOD_8PSK,
+    MOD_16QAM,
+    MOD_64QAM,
+    MOD_256QAM,
+    MOD_16APSK,
+    MOD_32APSK,
+    NUM_MODULATIONS
+};
+
+// Test patterns for the cyclic transmission test
+enum test_pattern {
+    PATTERN_SINGLE_SYMBOL,
+    PATTERN_SYMBOL_CYCLE,
+    PATTERN_PRBS7,
+    PATTERN_PRBS9,
+    PATTERN_PRBS15,
+    NUM_TEST_PATTERNS
+};
+#define TEST_SYMBOL_HOLD_SAMPLES 4096   // Samples each symbol is held for in the symbol cycle pattern
+#define TEST_MIN_PATTERN_SAMPLES 4096   // Short patterns are repeated until they are at least this long
+
+// A constellation maps each symbol (bits_per_symbol bits of data, most significant bits first) to an
+// I and Q value. Lookup tables and the inner loop used for mapping are specialized per modulation order
+// by set_up_constellations, so mapping never branches on the order per symbol.
+struct constellation {
+    enum modulation_id id;
+    const char *name;
+    int bits_per_symbol;
+    int num_points;
+    int16_t i[MAX_CONSTELLATION_POINTS];                // I value of each symbol
+    int16_t q[MAX_CONSTELLATION_POINTS];                // Q value of each symbol
+    uint32_t symbol_table[MAX_CONSTELLATION_POINTS];    // Packed IQ sample of each symbol
+    uint32_t byte_table[256][GROUP_SYMBOLS];            // Packed IQ samples of each byte, when bits_per_symbol divides 8
+    uint8_t symbol_bytes[4][16];                        // I low, I high, Q low and Q high bytes for the NEON kernels
+    size_t (*map_bytes)(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq);
+};
+
+// Function prototypes
+void qpsk_modulation(int bitpair, int16_t *i, int16_t *q);
+void sxtn_qam_modulation(int fourbit, int16_t *i, int16_t *q);
+void set_up_constellations();
+int verify_constellations();
+const struct constellation *get_constellation(enum modulation_id id);
+const struct constellation *find_constellation(const char *name);
+size_t constellation_symbols(const struct constellation *c, size_t num_bytes);
+size_t constellation_bytes(const struct constellation *c, size_t num_symbols);
+size_t map_bytes(const struct constellation *c, const unsigned char *data, size_t num_bytes, uint32_t *iq);
+const char *test_pattern_name(enum test_pattern pattern);
+size_t test_pattern_samples(const struct constellation *c, enum test_pattern pattern);
+void build_test_pattern(const struct constellation *c, enum test_pattern pattern, int symbol, uint32_t *iq);
+
+#endif /* MODULATION_H */
@@ -0,0 +1,117 @@
+/* Data parallel modulation of a packet for MARLIN SDR */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "transmitter.h"
+
+// Worker threads. The calling thread modulates slice 0 and worker n modulates slice n + 1.
+static int num_threads = 1;
+static pthread_t workers[MAX_MODULATION_THREADS - 1];
+static pthread_barrier_t start_barrier;     // Released once a job is set up
+static pthread_barrier_t done_barrier;      // Released once every slice is modulated
+static struct modulation_job job;
+static volatile int quit = false;
+
+// Modulates one of a number of slices of the current job. The data is split on groups of 8 symbols, so every slice
+// starts at a known sample and the modulated bit stream is the same as when modulated in one piece.
+// The last slice also pads the packet.
+static void modulate_slice(int slice, int slices) {
+    const struct constellation *c = job.c;
+    size_t groups = (job.num_data_bytes + c->bits_per_symbol - 1) / c->bits_per_symbol;
+    size_t first_group = groups * slice / slices;
+    size_t end_group = groups * (slice + 1) / slices;
+    size_t first_byte = first_group * c->bits_per_symbol;
+    size_t end_byte = end_group * c->bits_per_symbol;
+    uint32_t *iq = job.samples + first_group * GROUP_SYMBOLS;
+
+    if(end_byte > job.num_data_bytes) {
+        end_byte = job.num_data_bytes;
+    }
+    if(end_byte > first_byte) {
+        iq += map_bytes(c, job.data + first_byte, end_byte - first_byte, iq);
+    }
+    if(slice == slices - 1) {
+        while(iq < job.samples_end) {
+            *iq++ = c->symbol_table[0];
+        }
+    }
+}
+
+// Worker thread, modulates its slice of every job until shut down
+static void *modulation_worker(void *arg) {
+    int slice = (int)(intptr_t)arg;
+
+    unpin_thread();     // Started from the command line interface, which is pinned in real-time mode
+    while(1) {
+        pthread_barrier_wait(&start_barrier);
+        if(quit) {
+            break;
+        }
+        modulate_slice(slice, num_threads);
+        pthread_barrier_wait(&done_barrier);
+    }
+    return NULL;
+}
+
+// Starts the worker threads so that each packet is modulated by the given number of threads
+void set_up_modulation_threads(int threads) {
+    if(threads < 1 || threads > MAX_MODULATION_THREADS) {
+        printf("error: modulation threads must be between 1 and %d\n", MAX_MODULATION_THREADS);
+        exit(0);
+    }
+    num_threads = threads;
+    if(num_threads == 1) {
+        return;
+    }
+
+    printf("Setting up %d modulation threads\n", num_threads);
+    pthread_barrier_init(&start_barrier, NULL, num_threads);
+    pthread_barrier_init(&done_barrier, NULL, num_threads);
+    for(int n = 0; n < num_threads - 1; n++) {
+        if(pthread_create(&workers[n], NULL, modulation_worker, (void *)(intptr_t)(n + 1)) != 0) {
+            printf("error: could not start modulation threads\n");
+            exit(0);
+        }
+    }
+}
+
+// Returns the number of threads modulating each packet
+int get_modulation_threads() {
+    return num_threads;
+}
+
+// Modulates data into samples and pads the rest of the samples up to samples_end with 0's.
+// With more than one modulation thread, every thread modulates a slice of the data and this
+// returns once all slices are done.
+void modulate_and_pad(const struct constellation *c, const unsigned char *data, size_t num_data_bytes,
+                      uint32_t *samples, uint32_t *samples_end) {
+    job.c = c;
+    job.data = data;
+    job.num_data_bytes = num_data_bytes;
+    job.samples = samples;
+    job.samples_end = samples_end;
+
+    if(num_threads == 1 || num_data_bytes < PARALLEL_MIN_BYTES) {
+        modulate_slice(0, 1);
+        return;
+    }
+    pthread_barrier_wait(&start_barrier);
+    modulate_slice(0, num_threads);
+    pthread_barrier_wait(&done_barrier);
+}
+
+// Stops the worker threads
+void shut_down_modulation_threads() {
+    if(num_threads == 1) {
+        return;
+    }
+    quit = true;
+    pthread_barrier_wait(&start_barrier);
+    for(int n = 0; n < num_threads - 1; n++) {
+        pthread_join(workers[n], NULL);
+    }
+    pthread_barrier_destroy(&start_barrier);
+    pthread_barrier_destroy(&done_barrier);
+    num_threads = 1;
+}
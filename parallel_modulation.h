@@ -0,0 +1,28 @@
+#ifndef PARALLEL_MODULATION_H
+#define PARALLEL_MODULATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "modulation.h"
+
+// Parallel modulation configuration
+#define MAX_MODULATION_THREADS 4        // Threads modulating one packet, including the calling thread
+#define PARALLEL_MIN_BYTES 4096         // Less data than this is modulated by the calling thread alone
+
+// A packet being modulated, split into one slice per thread
+struct modulation_job {
+    const struct constellation *c;
+    const unsigned char *data;
+    size_t num_data_bytes;
+    uint32_t *samples;          // First data sample of the packet
+    uint32_t *samples_end;      // End of the packet, the samples after the data are padded
+};
+
+// Function prototypes
+void set_up_modulation_threads(int threads);
+int get_modulation_threads();
+void modulate_and_pad(const struct constellation *c, const unsigned char *data, size_t num_data_bytes,
+                      uint32_t *samples, uint32_t *samples_end);
+void shut_down_modulation_threads();
+
+#endif /* PARALLEL_MODULATION_H */
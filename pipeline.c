@@ -0,0 +1,220 @@
+/* Read, modulate and push pipeline for MARLIN SDR */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "transmitter.h"
+
+// Sleeps until the ring index at addr changes from seen, the index is woken, or PIPELINE_WAIT_NS passes
+static void futex_wait(uint32_t *addr, uint32_t seen) {
+    struct timespec timeout = { 0, PIPELINE_WAIT_NS };
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, seen, &timeout, NULL, 0);
+}
+
+// Wakes a stage sleeping on the ring index at addr
+static void futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+// Adds a packet to a ring (producer side)
+static void ring_push(struct spsc_ring *r, struct packet *pkt) {
+    uint32_t head = r->head;
+    r->slots[head & (PIPELINE_PACKETS - 1)] = pkt;
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    futex_wake(&r->head);
+}
+
+// Takes the oldest packet from a ring (consumer side), waiting while the ring is empty.
+// Returns NULL if the pipeline is stopped or interrupted while waiting.
+static struct packet *ring_pop(struct spsc_ring *r, volatile int *stop) {
+    uint32_t tail = r->tail;
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    struct packet *pkt;
+
+    if(head == tail) {
+        r->empty_waits++;
+        while(head == tail) {
+            if(*stop || !running) {
+                return NULL;
+            }
+            futex_wait(&r->head, head);
+            head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        }
+    }
+    r->pops++;
+    r->occupancy_sum += head - tail;
+    pkt = r->slots[tail & (PIPELINE_PACKETS - 1)];
+    __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+    return pkt;
+}
+
+// Waits until a ring holds count packets or its newest packet is the last one (consumer side).
+// Returns early if the pipeline is stopped or interrupted while waiting.
+static void ring_wait_fill(struct spsc_ring *r, uint32_t count, volatile int *stop) {
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+    while(head - r->tail < count) {
+        if(head != r->tail && r->slots[(head - 1) & (PIPELINE_PACKETS - 1)]->last) {
+            return;
+        }
+        if(*stop || !running) {
+            return;
+        }
+        futex_wait(&r->head, head);
+        head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    }
+}
+
+// Reader stage. Fills free packets with a packet worth of data from the input.
+static void *reader_stage(void *arg) {
+    struct pipeline *p = arg;
+    struct packet *pkt;
+    off_t total_data_bytes = 0;
+    bool last;
+
+    pin_io_thread();    // File I/O stays off the push core in real-time mode
+    do {
+        if((pkt = ring_pop(&p->free_packets, &p->stop)) == NULL) {
+            break;
+        }
+        pkt->num_data_bytes = read_data_input(p->input, pkt->buffer, p->framer->chunk_data_bytes, &pkt->data, &pkt->window);
+        total_data_bytes += pkt->num_data_bytes;
+        pkt->total_data_bytes = total_data_bytes;
+        pkt->last = last = p->input->end;
+        ring_push(&p->read_packets, pkt);
+    } while(!last);     // pkt belongs to the next stages once pushed
+
+    return NULL;
+}
+
+// Modulator stage. Turns packets of data into packets of frames. Not pinned in real-time mode, so it
+// can use the push core whenever the push thread waits on the DMA.
+static void *modulator_stage(void *arg) {
+    struct pipeline *p = arg;
+    struct packet *pkt;
+    bool last;
+
+    unpin_thread();
+    do {
+        if((pkt = ring_pop(&p->read_packets, &p->stop)) == NULL) {
+            break;
+        }
+        pkt->num_samples = frame_chunk(p->framer, pkt->data, pkt->num_data_bytes, pkt->last, pkt->samples);
+        release_input_window(pkt->window);
+        pkt->window = NULL;
+        last = pkt->last;
+        ring_push(&p->modulated_packets, pkt);
+    } while(!last);     // pkt can be refilled by the reader once pushed
+
+    return NULL;
+}
+
+// Pushes the first num_samples of the transmit buffer. Returns false after printing the error if the push fails.
+static bool push_samples(size_t num_samples) {
+    ssize_t nbytes_tx = push_tx_buffer_samples(num_samples);
+    if(nbytes_tx < 0) {
+        print_push_error(nbytes_tx);
+        return false;
+    }
+    return true;
+}
+
+// Transmit data framed by a framer through the read, modulate and push pipeline. Returns true once all
+// data has been pushed or the transmission is interrupted, false if a push fails.
+bool transmit_pipeline(struct data_input *input, struct framer *framer) {
+    struct pipeline p;
+    struct packet *pkt;
+    size_t fill = 0;        // Samples already in the transmit buffer
+    size_t pos, num_copied;
+    bool last = false, pushed = true;
+
+    memset(&p, 0, sizeof(p));
+    p.input = input;
+    p.framer = framer;
+
+    // Set up packet buffers, all of them start out free
+    for(int n = 0; n < PIPELINE_PACKETS; n++) {
+        pkt = &p.packets[n];
+        pkt->buffer = malloc(framer->chunk_data_bytes);
+        null_error_check((void *)pkt->buffer, "packet data");
+        pkt->samples = malloc(framer->chunk_samples * sizeof(uint32_t));
+        null_error_check((void *)pkt->samples, "packet samples");
+        ring_push(&p.free_packets, pkt);
+    }
+
+    // Start the reader and modulator
+    if(pthread_create(&p.reader_thread, NULL, reader_stage, &p) != 0 ||
+       pthread_create(&p.modulator_thread, NULL, modulator_stage, &p) != 0) {
+        printf("error: could not start pipeline threads\n");
+        exit(0);
+    }
+
+    // The calling thread becomes the push thread
+    enter_realtime_push_thread();
+
+    // Let the first packets queue up so that they are pushed back to back into the kernel buffer queue
+    ring_wait_fill(&p.modulated_packets, get_prefill_buffers(), &p.stop);
+
+    // Pusher stage. Copies the frames of each packet into the transmit buffer and pushes it whenever it
+    // is full. What is left of a short packet (the end of the data, or a flushed stream) is pushed as a
+    // short buffer right away instead of waiting for more frames. The modulator cannot frame straight into
+    // the transmit buffer like the event loop does, since only the block being filled is mapped and it moves
+    // on each push, so the copy is the price of modulating ahead on another core (see QPSK buffer copy in -B).
+    while(!last && pushed && (pkt = ring_pop(&p.modulated_packets, &p.stop)) != NULL) {
+        for(pos = 0; pos < pkt->num_samples && pushed; pos += num_copied) {
+            num_copied = fill_tx_buffer(fill, pkt->samples + pos, pkt->num_samples - pos);
+            fill += num_copied;
+            if(fill == tx_buffer_samples()) {
+                pushed = push_samples(fill);
+                fill = 0;
+            }
+        }
+        if(pushed && fill > 0 && (pkt->last || pkt->num_data_bytes < framer->chunk_data_bytes)) {
+            pushed = push_samples(pad_tx_buffer(fill));
+            fill = 0;
+        }
+        print_transmit_progress(pkt->total_data_bytes, input->size);
+        last = pkt->last;
+        ring_push(&p.free_packets, pkt);
+    }
+    leave_realtime_push_thread();
+    printf("\n");   // Needed since print_transmit_progress does not print a newline character
+
+    // Stop the other stages and clean up
+    p.stop = true;
+    pthread_join(p.reader_thread, NULL);
+    pthread_join(p.modulator_thread, NULL);
+    for(int n = 0; n < PIPELINE_PACKETS; n++) {
+        release_input_window(p.packets[n].window);     // Read, but not modulated before the stop
+        free(p.packets[n].buffer);
+        free(p.packets[n].samples);
+    }
+
+    print_pipeline_stats(&p);
+    return pushed;
+}
+
+// Prints how full the input ring of each stage was on average and how often the stage had to wait for
+// input. Packets queue up in front of the slowest stage, so the stage with the fullest input ring is the bottleneck.
+void print_pipeline_stats(const struct pipeline *p) {
+    const char *stage_names[3] = { "reader", "modulator", "pusher" };
+    const struct spsc_ring *input_rings[3] = { &p->free_packets, &p->read_packets, &p->modulated_packets };
+    double occupancy, max_occupancy = -1;
+    int bottleneck = 0;
+
+    printf("Pipeline stages (input ring occupancy out of %d packets):\n", PIPELINE_PACKETS);
+    for(int stage = 0; stage < 3; stage++) {
+        const struct spsc_ring *r = input_rings[stage];
+        occupancy = r->pops ? (double)r->occupancy_sum / r->pops : 0;
+        printf("- %-9s average occupancy %.2f, waited for input %llu times, %llu packets\n",
+               stage_names[stage], occupancy, r->empty_waits, r->pops);
+        if(occupancy > max_occupancy) {
+            max_occupancy = occupancy;
+            bottleneck = stage;
+        }
+    }
+    printf("Bottleneck stage: %s\n", stage_names[bottleneck]);
+}
@@ -0,0 +1,60 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "modulation.h"
+#include "framing.h"
+#include "input.h"
+
+// Pipeline configuration
+#define PIPELINE_PACKETS 8              // Packet buffers in flight between the stages (power of two)
+#define PIPELINE_WAIT_NS 100000000      // Longest a stage sleeps on an empty ring before checking for a stop (100 ms)
+
+// Lock-free single producer, single consumer ring of packets. Head and tail are free running counters
+// kept on separate cache lines, each only written by one side. A consumer sleeps on the head with a futex
+// while the ring is empty. The ring holds every packet of the pipeline, so it can never be full.
+struct spsc_ring {
+    struct packet *slots[PIPELINE_PACKETS];
+    uint32_t head __attribute__((aligned(64)));     // Next slot to write, only written by the producer
+    uint32_t tail __attribute__((aligned(64)));     // Next slot to read, only written by the consumer
+    unsigned long long pops;                        // Packets taken by the consumer
+    unsigned long long occupancy_sum;               // Sum of packets queued each time the consumer took one
+    unsigned long long empty_waits;                 // Times the consumer found the ring empty and had to wait
+};
+
+// A packet buffer passed between the stages, holding a chunk of data and the frames it is modulated into
+struct packet {
+    unsigned char *buffer;          // Buffer for data copied from the input
+    const unsigned char *data;      // Data read from the input, in buffer or in a mapped window
+    struct input_window *window;    // Mapped window or asynchronous input block holding the data, released once modulated
+    size_t num_data_bytes;
+    uint32_t *samples;              // Modulated frames (preamble, sync word, frame header and data each)
+    size_t num_samples;
+    off_t total_data_bytes;         // Data bytes read up to and including this packet, for progress output
+    bool last;                      // End of transmission data was reached with this packet
+};
+
+// A read, modulate and push pipeline. The reader and modulator run on their own threads and the
+// pusher runs on the calling thread, so the DMA is fed while the next packets are read and modulated.
+// The pusher streams the frames of each packet into transmit buffers, which need not line up with frames.
+struct pipeline {
+    struct data_input *input;
+    struct framer *framer;                  // Only used by the modulator once the pipeline runs
+    struct packet packets[PIPELINE_PACKETS];
+    struct spsc_ring free_packets;          // Pusher -> reader
+    struct spsc_ring read_packets;          // Reader -> modulator
+    struct spsc_ring modulated_packets;     // Modulator -> pusher
+    pthread_t reader_thread;
+    pthread_t modulator_thread;
+    volatile int stop;
+};
+
+// Function prototypes
+bool transmit_pipeline(struct data_input *input, struct framer *framer);
+void print_pipeline_stats(const struct pipeline *p);
+
+#endif /* PIPELINE_H */
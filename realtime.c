@@ -0,0 +1,107 @@
+/* Real-time scheduling of the push thread for MARLIN SDR */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "transmitter.h"
+
+// Real-time mode state
+static bool realtime_mode = false;
+static int push_cpu = -1;                   // Last online core, -1 if there is only one
+static int saved_policy;                    // Scheduling of the push thread before entering real-time mode
+static struct sched_param saved_param;
+static cpu_set_t saved_cpus;
+
+// Turns on real-time mode. Locks all current and future memory of the process, so packet buffers are
+// faulted in when they are allocated instead of on their first use in the push loop.
+void set_up_realtime() {
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    printf("Setting up real-time mode\n");
+    realtime_mode = true;
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        printf("warning: could not lock memory, page faults can stall the push loop\n");
+    }
+    push_cpu = num_cpus > 1 ? (int)num_cpus - 1 : -1;
+    if(push_cpu < 0) {
+        printf("warning: only one core, the push thread is not pinned\n");
+    }
+    pin_io_thread();
+}
+
+// Returns true if real-time mode is on
+bool get_realtime_mode() {
+    return realtime_mode;
+}
+
+// Pins a thread to a single core
+static void pin_thread(pthread_t thread, int cpu) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if(pthread_setaffinity_np(thread, sizeof(cpus), &cpus) != 0) {
+        printf("warning: could not pin thread to core %d\n", cpu);
+    }
+}
+
+// Touches a stack area the size of PREFAULT_STACK_BYTES so that the push loop does not fault in stack pages
+static void prefault_stack() {
+    volatile unsigned char stack[PREFAULT_STACK_BYTES];
+    for(int n = 0; n < PREFAULT_STACK_BYTES; n += 4096) {
+        stack[n] = 0;
+    }
+    (void)stack[0];
+}
+
+// Moves the calling thread to the push core with SCHED_FIFO priority, if real-time mode is on.
+// The previous scheduling is restored with leave_realtime_push_thread.
+void enter_realtime_push_thread() {
+    struct sched_param param = { .sched_priority = REALTIME_PRIORITY };
+    pthread_t self = pthread_self();
+
+    if(!realtime_mode) {
+        return;
+    }
+    pthread_getschedparam(self, &saved_policy, &saved_param);
+    pthread_getaffinity_np(self, sizeof(saved_cpus), &saved_cpus);
+    if(push_cpu >= 0) {
+        pin_thread(self, push_cpu);
+    }
+    if(pthread_setschedparam(self, SCHED_FIFO, &param) != 0) {
+        printf("warning: could not set SCHED_FIFO priority %d (needs root)\n", REALTIME_PRIORITY);
+    }
+    prefault_stack();
+}
+
+// Restores the scheduling of the calling thread from before enter_realtime_push_thread
+void leave_realtime_push_thread() {
+    pthread_t self = pthread_self();
+
+    if(!realtime_mode) {
+        return;
+    }
+    pthread_setschedparam(self, saved_policy, &saved_param);
+    pthread_setaffinity_np(self, sizeof(saved_cpus), &saved_cpus);
+}
+
+// Pins the calling thread to the I/O core, if real-time mode is on and there is a separate push core
+void pin_io_thread() {
+    if(realtime_mode && push_cpu >= 0) {
+        pin_thread(pthread_self(), IO_CPU);
+    }
+}
+
+// Lets the calling thread run on any core again. Threads inherit the pinning of the thread that starts them.
+void unpin_thread() {
+    cpu_set_t cpus;
+
+    if(realtime_mode && push_cpu >= 0) {
+        CPU_ZERO(&cpus);
+        for(int cpu = 0; cpu <= push_cpu; cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+}
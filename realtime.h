@@ -0,0 +1,21 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <stdbool.h>
+
+// Real-time mode configuration. The Zynq on the ADALM-PLUTO has two cores. The push thread gets the last
+// core with a SCHED_FIFO priority above iiod, ssh and the USB gadget services, file I/O and the command
+// line interface stay on the first core.
+#define REALTIME_PRIORITY 50
+#define IO_CPU 0
+#define PREFAULT_STACK_BYTES (64 * 1024)    // Stack touched by the push thread before it starts pushing
+
+// Function prototypes
+void set_up_realtime();
+bool get_realtime_mode();
+void enter_realtime_push_thread();
+void leave_realtime_push_thread();
+void pin_io_thread();
+void unpin_thread();
+
+#endif /* REALTIME_H */
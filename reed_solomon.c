@@ -0,0 +1,450 @@
+/* Reed-Solomon outer code for MARLIN SDR */
+
+#include "transmitter.h"
+
+#define RS_VERIFY_CODEWORDS 40          // Codewords of random data and errors checked by verify_reed_solomon
+#define RS_VERIFY_STREAM_BYTES 1000     // Data of the stream of codewords checked by verify_reed_solomon
+
+// Codeword length of the outer code, 0 for no outer code, set with set_rs_block_bytes
+static size_t rs_block_bytes = 0;
+
+// GF(256) log and antilog tables. The antilog table is doubled so the sum of two logs needs no reduction,
+// and the log of 0 is left at 0, so callers check for 0 before using it.
+static uint8_t gf_log[256];
+static uint8_t gf_exp[2 * RS_SYMBOLS];
+
+// Generator polynomial coefficients, gen[i] of x^i with gen[RS_PARITY_BYTES] = 1, and their multiples by every
+// feedback byte in the layout of the encoder parity words
+static uint8_t generator[RS_PARITY_BYTES + 1];
+static uint64_t generator_multiples[256][RS_PARITY_BYTES / 8];
+
+// Returns the product of two field elements
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    return (a == 0 || b == 0) ? 0 : gf_exp[gf_log[a] + gf_log[b]];
+}
+
+// Returns a / b for a nonzero b
+static inline uint8_t gf_div(uint8_t a, uint8_t b) {
+    return a == 0 ? 0 : gf_exp[gf_log[a] + RS_SYMBOLS - gf_log[b]];
+}
+
+// Returns alpha to a power from 0 to 254
+static inline uint8_t gf_pow_alpha(int power) {
+    return gf_exp[power];
+}
+
+// Builds the field tables, the generator polynomial and the encoder tables
+void set_up_reed_solomon() {
+    int element = 1;
+
+    for(int power = 0; power < RS_SYMBOLS; power++) {
+        gf_exp[power] = (uint8_t)element;
+        gf_exp[power + RS_SYMBOLS] = (uint8_t)element;
+        gf_log[element] = (uint8_t)power;
+        element <<= 1;
+        if(element & 0x100) {
+            element ^= RS_FIELD_POLYNOMIAL;
+        }
+    }
+
+    // Multiply (x - alpha^(FIRST_ROOT + i)) together, subtraction being addition in the field
+    memset(generator, 0, sizeof(generator));
+    generator[0] = 1;
+    for(int i = 0; i < RS_PARITY_BYTES; i++) {
+        uint8_t root = gf_pow_alpha(RS_FIRST_ROOT + i);
+        for(int j = i + 1; j > 0; j--) {
+            generator[j] = generator[j - 1] ^ gf_mul(generator[j], root);
+        }
+        generator[0] = gf_mul(generator[0], root);
+    }
+
+    // Parity byte j is the remainder coefficient of x^(31 - j), so it takes the feedback times gen[31 - j]
+    for(int feedback = 0; feedback < 256; feedback++) {
+        memset(generator_multiples[feedback], 0, sizeof(generator_multiples[feedback]));
+        for(int j = 0; j < RS_PARITY_BYTES; j++) {
+            uint64_t product = gf_mul((uint8_t)feedback, generator[RS_PARITY_BYTES - 1 - j]);
+            generator_multiples[feedback][j / 8] |= product << (8 * (j % 8));
+        }
+    }
+}
+
+// Sets the codeword length of the outer code, 0 for none, RS_SYMBOLS for RS(255,223) or shorter for a shortened
+// code. Exits if it is out of range.
+void set_rs_block_bytes(size_t num_bytes) {
+    if(num_bytes != 0 && (num_bytes < MIN_RS_BLOCK_BYTES || num_bytes > RS_SYMBOLS)) {
+        printf("error: Reed-Solomon codewords must be between %d and %d bytes\n", MIN_RS_BLOCK_BYTES, RS_SYMBOLS);
+        exit(0);
+    }
+    rs_block_bytes = num_bytes;
+}
+
+// Returns the codeword length of the outer code, 0 for none
+size_t get_rs_block_bytes() {
+    return rs_block_bytes;
+}
+
+// Returns the number of coded bytes of num_data_bytes, the last codeword shortened to the data left
+size_t rs_coded_bytes(size_t num_data_bytes) {
+    size_t block_data_bytes = rs_block_bytes - RS_PARITY_BYTES;
+
+    if(rs_block_bytes == 0) {
+        return num_data_bytes;
+    }
+    return num_data_bytes + (num_data_bytes + block_data_bytes - 1) / block_data_bytes * RS_PARITY_BYTES;
+}
+
+// Returns the most data bytes whose coded bytes fit in num_coded_bytes
+size_t rs_data_bytes(size_t num_coded_bytes) {
+    size_t num_rest_bytes;
+
+    if(rs_block_bytes == 0) {
+        return num_coded_bytes;
+    }
+    num_rest_bytes = num_coded_bytes % rs_block_bytes;
+    return num_coded_bytes / rs_block_bytes * (rs_block_bytes - RS_PARITY_BYTES) +
+           (num_rest_bytes > RS_PARITY_BYTES ? num_rest_bytes - RS_PARITY_BYTES : 0);
+}
+
+// Starts encoding a frame into coded, which holds rs_coded_bytes of the frame
+void start_rs_encoder(struct rs_encoder *enc, unsigned char *coded) {
+    memset(enc->parity, 0, sizeof(enc->parity));
+    enc->num_block_bytes = 0;
+    enc->coded = coded;
+    enc->coded_start = coded;
+}
+
+// Writes the parity of the current codeword after its data and clears it for the next one
+static void put_parity(struct rs_encoder *enc) {
+    for(int j = 0; j < RS_PARITY_BYTES; j++) {
+        *enc->coded++ = (unsigned char)(enc->parity[j / 8] >> (8 * (j % 8)));
+    }
+    memset(enc->parity, 0, sizeof(enc->parity));
+    enc->num_block_bytes = 0;
+}
+
+// Divides data bytes into the parity, shifting it a byte and adding the generator times the feedback per byte
+static void update_parity(uint64_t *parity, const unsigned char *data, size_t num_bytes) {
+    uint64_t p0 = parity[0], p1 = parity[1], p2 = parity[2], p3 = parity[3];
+
+    for(size_t n = 0; n < num_bytes; n++) {
+        const uint64_t *multiple = generator_multiples[(data[n] ^ p0) & 0xFF];
+        p0 = ((p0 >> 8) | (p1 << 56)) ^ multiple[0];
+        p1 = ((p1 >> 8) | (p2 << 56)) ^ multiple[1];
+        p2 = ((p2 >> 8) | (p3 << 56)) ^ multiple[2];
+        p3 = (p3 >> 8) ^ multiple[3];
+    }
+    parity[0] = p0;
+    parity[1] = p1;
+    parity[2] = p2;
+    parity[3] = p3;
+}
+
+// Divides the data of two whole codewords into their parity at once. Each byte waits for the table lookup of
+// the byte before it, so two independent codewords keep twice as many lookups in flight.
+static void update_parity_pair(uint64_t *parity_a, uint64_t *parity_b, const unsigned char *data_a,
+                               const unsigned char *data_b, size_t num_bytes) {
+    uint64_t a0 = 0, a1 = 0, a2 = 0, a3 = 0, b0 = 0, b1 = 0, b2 = 0, b3 = 0;
+
+    for(size_t n = 0; n < num_bytes; n++) {
+        const uint64_t *multiple_a = generator_multiples[(data_a[n] ^ a0) & 0xFF];
+        const uint64_t *multiple_b = generator_multiples[(data_b[n] ^ b0) & 0xFF];
+        a0 = ((a0 >> 8) | (a1 << 56)) ^ multiple_a[0];
+        b0 = ((b0 >> 8) | (b1 << 56)) ^ multiple_b[0];
+        a1 = ((a1 >> 8) | (a2 << 56)) ^ multiple_a[1];
+        b1 = ((b1 >> 8) | (b2 << 56)) ^ multiple_b[1];
+        a2 = ((a2 >> 8) | (a3 << 56)) ^ multiple_a[2];
+        b2 = ((b2 >> 8) | (b3 << 56)) ^ multiple_b[2];
+        a3 = (a3 >> 8) ^ multiple_a[3];
+        b3 = (b3 >> 8) ^ multiple_b[3];
+    }
+    parity_a[0] = a0;
+    parity_a[1] = a1;
+    parity_a[2] = a2;
+    parity_a[3] = a3;
+    parity_b[0] = b0;
+    parity_b[1] = b1;
+    parity_b[2] = b2;
+    parity_b[3] = b3;
+}
+
+// Encodes more data of the frame. The data is copied through and each full codeword is followed by its parity.
+void rs_encode(struct rs_encoder *enc, const unsigned char *data, size_t num_bytes) {
+    size_t block_data_bytes = rs_block_bytes - RS_PARITY_BYTES, num_part_bytes;
+
+    // Pairs of whole codewords while there are any
+    while(enc->num_block_bytes == 0 && num_bytes >= 2 * block_data_bytes) {
+        uint64_t parity_b[RS_PARITY_BYTES / 8];
+        update_parity_pair(enc->parity, parity_b, data, data + block_data_bytes, block_data_bytes);
+        memcpy(enc->coded, data, block_data_bytes);
+        enc->coded += block_data_bytes;
+        put_parity(enc);
+        memcpy(enc->coded, data + block_data_bytes, block_data_bytes);
+        enc->coded += block_data_bytes;
+        memcpy(enc->parity, parity_b, sizeof(parity_b));
+        put_parity(enc);
+        data += 2 * block_data_bytes;
+        num_bytes -= 2 * block_data_bytes;
+    }
+    while(num_bytes > 0) {
+        num_part_bytes = block_data_bytes - enc->num_block_bytes;
+        if(num_part_bytes > num_bytes) {
+            num_part_bytes = num_bytes;
+        }
+        memcpy(enc->coded, data, num_part_bytes);
+        update_parity(enc->parity, data, num_part_bytes);
+        enc->coded += num_part_bytes;
+        enc->num_block_bytes += num_part_bytes;
+        if(enc->num_block_bytes == block_data_bytes) {
+            put_parity(enc);
+        }
+        data += num_part_bytes;
+        num_bytes -= num_part_bytes;
+    }
+}
+
+// Ends the frame with the parity of its shortened last codeword. Returns the number of coded bytes.
+size_t finish_rs_encoder(struct rs_encoder *enc) {
+    if(enc->num_block_bytes > 0) {
+        put_parity(enc);
+    }
+    return enc->coded - enc->coded_start;
+}
+
+// Returns true if the parity bytes of a codeword match the parity its data was divided into
+static bool is_parity(const uint64_t *parity, const unsigned char *codeword_parity) {
+    bool match = true;
+
+    for(int j = 0; j < RS_PARITY_BYTES; j++) {
+        match &= (uint8_t)(parity[j / 8] >> (8 * (j % 8))) == codeword_parity[j];
+    }
+    return match;
+}
+
+// Corrects a codeword of num_bytes with errors in place, given the parity its data was divided into.
+// Returns the number of corrected bytes, or -1 if there are more errors than the code can correct.
+static int correct_codeword(unsigned char *codeword, size_t num_bytes, const uint64_t *parity) {
+    const unsigned char *codeword_parity = codeword + num_bytes - RS_PARITY_BYTES;
+    uint8_t syndromes[RS_PARITY_BYTES], locator[RS_PARITY_BYTES + 1], previous[RS_PARITY_BYTES + 1];
+    uint8_t evaluator[RS_PARITY_BYTES], temp[RS_PARITY_BYTES + 1], terms[RS_PARITY_BYTES / 2 + 1];
+    uint8_t discrepancy, previous_discrepancy = 1;
+    int num_errors = 0, shift = 1, num_found = 0, power;
+
+    // Syndromes S_i = r(alpha^(FIRST_ROOT + i)) of the received codeword r(x). The roots are roots of the
+    // generator, so r(x) can be replaced by its remainder, the parity of its data plus its parity bytes, and
+    // only 32 coefficients are evaluated instead of the whole codeword.
+    memset(syndromes, 0, sizeof(syndromes));
+    for(int j = 0; j < RS_PARITY_BYTES; j++) {
+        uint8_t remainder = (uint8_t)(parity[j / 8] >> (8 * (j % 8))) ^ codeword_parity[j];
+        for(int i = 0; i < RS_PARITY_BYTES; i++) {
+            syndromes[i] = (syndromes[i] == 0 ? 0 : gf_exp[gf_log[syndromes[i]] + RS_FIRST_ROOT + i]) ^ remainder;
+        }
+    }
+
+    // Berlekamp-Massey: the shortest error locator polynomial generating the syndromes
+    memset(locator, 0, sizeof(locator));
+    memset(previous, 0, sizeof(previous));
+    locator[0] = 1;
+    previous[0] = 1;
+    for(int r = 0; r < RS_PARITY_BYTES; r++) {
+        discrepancy = syndromes[r];
+        for(int i = 1; i <= num_errors; i++) {
+            discrepancy ^= gf_mul(locator[i], syndromes[r - i]);
+        }
+        if(discrepancy == 0) {
+            shift++;
+            continue;
+        }
+        memcpy(temp, locator, sizeof(locator));
+        for(int i = 0; i + shift <= RS_PARITY_BYTES; i++) {
+            locator[i + shift] ^= gf_mul(gf_div(discrepancy, previous_discrepancy), previous[i]);
+        }
+        if(2 * num_errors <= r) {
+            num_errors = r + 1 - num_errors;
+            memcpy(previous, temp, sizeof(previous));
+            previous_discrepancy = discrepancy;
+            shift = 1;
+        } else {
+            shift++;
+        }
+    }
+    if(num_errors > RS_PARITY_BYTES / 2) {
+        return -1;
+    }
+
+    // Error evaluator polynomial, S(x) * locator(x) mod x^32
+    for(int i = 0; i < RS_PARITY_BYTES; i++) {
+        evaluator[i] = 0;
+        for(int j = 0; j <= i && j <= num_errors; j++) {
+            evaluator[i] ^= gf_mul(locator[j], syndromes[i - j]);
+        }
+    }
+
+    // Chien search over the positions of the codeword, and Forney's formula for the error values. Byte n is at
+    // X^-1 = alpha^power, and the terms of the locator there are updated from those at byte n - 1 with one
+    // multiplication each. With the first root at alpha^1 the error value is evaluator(X^-1) / locator'(X^-1),
+    // where locator'(X^-1) is the sum of the odd terms divided by X^-1.
+    power = (int)((RS_SYMBOLS + 1 - num_bytes) % RS_SYMBOLS);
+    for(int i = 0; i <= num_errors; i++) {
+        terms[i] = gf_mul(locator[i], gf_pow_alpha(power * i % RS_SYMBOLS));
+    }
+    for(size_t n = 0; n < num_bytes; n++) {
+        uint8_t even = 0, odd = 0, numerator = 0;
+
+        for(int i = 0; i <= num_errors; i += 2) {
+            even ^= terms[i];
+        }
+        for(int i = 1; i <= num_errors; i += 2) {
+            odd ^= terms[i];
+        }
+        if(even == odd) {
+            if(odd == 0) {
+                return -1;
+            }
+            for(int i = 0; i < RS_PARITY_BYTES; i++) {
+                numerator ^= gf_mul(evaluator[i], gf_pow_alpha(power * i % RS_SYMBOLS));
+            }
+            codeword[n] ^= gf_mul(gf_div(numerator, odd), gf_pow_alpha(power));
+            num_found++;
+        }
+        for(int i = 1; i <= num_errors; i++) {
+            terms[i] = gf_mul(terms[i], gf_pow_alpha(i));
+        }
+        power = (power + 1) % RS_SYMBOLS;
+    }
+    return num_found == num_errors ? num_found : -1;
+}
+
+// Corrects a codeword of num_bytes (RS_SYMBOLS or fewer for a shortened codeword) in place. Codewords without
+// errors are recognized by dividing them again with the encoder, which is much faster than the syndromes.
+// Returns the number of corrected bytes, or -1 if there are more errors than the code can correct.
+int rs_decode_codeword(unsigned char *codeword, size_t num_bytes) {
+    uint64_t parity[RS_PARITY_BYTES / 8] = { 0 };
+
+    update_parity(parity, codeword, num_bytes - RS_PARITY_BYTES);
+    if(is_parity(parity, codeword + num_bytes - RS_PARITY_BYTES)) {
+        return 0;
+    }
+    return correct_codeword(codeword, num_bytes, parity);
+}
+
+// Adds the corrected bytes of a codeword to a total, which stays -1 once a codeword could not be corrected
+static int add_corrected(int num_corrected, int result) {
+    return (result < 0 || num_corrected < 0) ? -1 : num_corrected + result;
+}
+
+// Decodes the coded bytes of num_data_bytes into data, correcting the codewords in place. Whole codewords are
+// checked in pairs like the encoder encodes them.
+// Returns the number of corrected bytes, or -1 if any codeword has more errors than the code can correct.
+int rs_decode(unsigned char *coded, size_t num_data_bytes, unsigned char *data) {
+    size_t block_data_bytes = rs_block_bytes - RS_PARITY_BYTES, num_block_bytes;
+    uint64_t parity_a[RS_PARITY_BYTES / 8], parity_b[RS_PARITY_BYTES / 8];
+    unsigned char *coded_b;
+    int num_corrected = 0;
+
+    while(num_data_bytes >= 2 * block_data_bytes) {
+        coded_b = coded + rs_block_bytes;
+        update_parity_pair(parity_a, parity_b, coded, coded_b, block_data_bytes);
+        if(!is_parity(parity_a, coded + block_data_bytes)) {
+            num_corrected = add_corrected(num_corrected, correct_codeword(coded, rs_block_bytes, parity_a));
+        }
+        if(!is_parity(parity_b, coded_b + block_data_bytes)) {
+            num_corrected = add_corrected(num_corrected, correct_codeword(coded_b, rs_block_bytes, parity_b));
+        }
+        memcpy(data, coded, block_data_bytes);
+        memcpy(data + block_data_bytes, coded_b, block_data_bytes);
+        coded += 2 * rs_block_bytes;
+        data += 2 * block_data_bytes;
+        num_data_bytes -= 2 * block_data_bytes;
+    }
+    while(num_data_bytes > 0) {
+        num_block_bytes = num_data_bytes < block_data_bytes ? num_data_bytes : block_data_bytes;
+        num_corrected = add_corrected(num_corrected, rs_decode_codeword(coded, num_block_bytes + RS_PARITY_BYTES));
+        memcpy(data, coded, num_block_bytes);
+        coded += num_block_bytes + RS_PARITY_BYTES;
+        data += num_block_bytes;
+        num_data_bytes -= num_block_bytes;
+    }
+    return num_corrected;
+}
+
+// Checks the encoder against the roots of the generator and the decoder against random errors, up to the
+// number the code can correct, in full and shortened codewords. Returns 0 if they agree, -1 otherwise.
+int verify_reed_solomon() {
+    unsigned char data[RS_SYMBOLS], coded[RS_SYMBOLS], received[RS_SYMBOLS];
+    static const size_t lengths[] = { RS_SYMBOLS, MIN_RS_BLOCK_BYTES, 100, 204 };
+    size_t saved_block_bytes = rs_block_bytes;
+    uint32_t state = 1;
+    int result = 0;
+
+    for(int codeword = 0; codeword < RS_VERIFY_CODEWORDS && result == 0; codeword++) {
+        size_t num_bytes = lengths[codeword % (sizeof(lengths) / sizeof(lengths[0]))];
+        int num_errors = codeword % (RS_PARITY_BYTES / 2 + 1);
+        struct rs_encoder enc;
+
+        fill_pseudo_random(data, num_bytes - RS_PARITY_BYTES, &state);
+        rs_block_bytes = num_bytes;
+        start_rs_encoder(&enc, coded);
+        rs_encode(&enc, data, num_bytes - RS_PARITY_BYTES);
+        if(finish_rs_encoder(&enc) != num_bytes || memcmp(coded, data, num_bytes - RS_PARITY_BYTES) != 0) {
+            result = -1;
+        }
+
+        // Every root of the generator is a root of every codeword
+        for(int i = 0; i < RS_PARITY_BYTES; i++) {
+            uint8_t value = 0;
+            for(size_t n = 0; n < num_bytes; n++) {
+                value = gf_mul(value, gf_pow_alpha(RS_FIRST_ROOT + i)) ^ coded[n];
+            }
+            if(value != 0) {
+                result = -1;
+            }
+        }
+
+        // Errors at distinct random positions with random nonzero values
+        memcpy(received, coded, num_bytes);
+        for(int e = 0; e < num_errors; e++) {
+            size_t position;
+            do {
+                position = next_pseudo_random(&state) % num_bytes;
+            } while(received[position] != coded[position]);
+            received[position] ^= (unsigned char)(next_pseudo_random(&state) % 255 + 1);
+        }
+        if(rs_decode_codeword(received, num_bytes) != num_errors || memcmp(received, coded, num_bytes) != 0) {
+            result = -1;
+        }
+    }
+
+    // A stream of whole codewords and a shortened one, encoded in one piece and a byte at a time, then decoded
+    // with an error in every codeword
+    if(result == 0) {
+        unsigned char stream[RS_VERIFY_STREAM_BYTES], coded_stream[2 * RS_VERIFY_STREAM_BYTES];
+        unsigned char reference[2 * RS_VERIFY_STREAM_BYTES], decoded[RS_VERIFY_STREAM_BYTES];
+        size_t num_coded_bytes;
+        struct rs_encoder enc;
+
+        fill_pseudo_random(stream, RS_VERIFY_STREAM_BYTES, &state);
+        rs_block_bytes = RS_SYMBOLS;
+        start_rs_encoder(&enc, coded_stream);
+        rs_encode(&enc, stream, RS_VERIFY_STREAM_BYTES);
+        num_coded_bytes = finish_rs_encoder(&enc);
+        start_rs_encoder(&enc, reference);
+        for(size_t n = 0; n < RS_VERIFY_STREAM_BYTES; n++) {
+            rs_encode(&enc, stream + n, 1);
+        }
+        if(num_coded_bytes != rs_coded_bytes(RS_VERIFY_STREAM_BYTES) || finish_rs_encoder(&enc) != num_coded_bytes ||
+           memcmp(coded_stream, reference, num_coded_bytes) != 0 ||
+           rs_data_bytes(num_coded_bytes) != RS_VERIFY_STREAM_BYTES) {
+            result = -1;
+        }
+        for(size_t n = 0; n < num_coded_bytes; n += RS_SYMBOLS) {
+            coded_stream[n] ^= 0xFF;
+        }
+        if(rs_decode(coded_stream, RS_VERIFY_STREAM_BYTES, decoded) !=
+               (int)((num_coded_bytes + RS_SYMBOLS - 1) / RS_SYMBOLS) ||
+           memcmp(decoded, stream, RS_VERIFY_STREAM_BYTES) != 0) {
+            result = -1;
+        }
+    }
+    rs_block_bytes = saved_block_bytes;
+    return result;
+}
@@ -0,0 +1,39 @@
+#ifndef REED_SOLOMON_H
+#define REED_SOLOMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Reed-Solomon outer code configuration. RS(255,223) over GF(256) with the field polynomial 0x11D, generator
+// roots alpha^1 to alpha^32 and 32 parity bytes, which corrects up to 16 byte errors per codeword. Shorter
+// codewords are the shortened code RS(n, n - 32). Data is split into codewords of n - 32 data bytes, each
+// followed by its parity, and the last codeword of a frame is shortened to the data left.
+#define RS_SYMBOLS 255                  // Longest codeword, bytes
+#define RS_PARITY_BYTES 32
+#define RS_FIELD_POLYNOMIAL 0x11D
+#define RS_FIRST_ROOT 1
+#define MIN_RS_BLOCK_BYTES (RS_PARITY_BYTES + 1)
+
+// Encodes a stream of bytes into codewords. The parity is kept in 4 words shifted a byte at a time, so each
+// data byte is one lookup of the generator multiples and 4 shifts and XORs.
+struct rs_encoder {
+    uint64_t parity[RS_PARITY_BYTES / 8];   // Parity byte j in bits 8 * (j % 8) of word j / 8
+    size_t num_block_bytes;                 // Data bytes in the current codeword
+    unsigned char *coded;                   // Next coded byte
+    unsigned char *coded_start;
+};
+
+// Function prototypes
+void set_up_reed_solomon();
+int verify_reed_solomon();
+void set_rs_block_bytes(size_t num_bytes);
+size_t get_rs_block_bytes();
+size_t rs_coded_bytes(size_t num_data_bytes);
+size_t rs_data_bytes(size_t num_coded_bytes);
+void start_rs_encoder(struct rs_encoder *enc, unsigned char *coded);
+void rs_encode(struct rs_encoder *enc, const unsigned char *data, size_t num_bytes);
+size_t finish_rs_encoder(struct rs_encoder *enc);
+int rs_decode_codeword(unsigned char *codeword, size_t num_bytes);
+int rs_decode(unsigned char *coded, size_t num_data_bytes, unsigned char *data);
+
+#endif /* REED_SOLOMON_H */
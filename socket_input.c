@@ -0,0 +1,124 @@
+/* TCP and UDP socket input for MARLIN SDR */
+
+#include <errno.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "transmitter.h"
+
+// Parses a listen spec of the form [tcp:|udp:]port. Exits if it is not one.
+static void parse_listen_spec(struct socket_listener *l, const char *spec) {
+    char *end;
+    long port;
+
+    l->datagram = false;
+    if(strncmp(spec, "udp:", 4) == 0) {
+        l->datagram = true;
+        spec += 4;
+    } else if(strncmp(spec, "tcp:", 4) == 0) {
+        spec += 4;
+    }
+    port = strtol(spec, &end, 10);
+    if(*spec == '\0' || *end != '\0' || port < 1 || port > 65535) {
+        printf("error: expected [tcp:|udp:]port to listen on, got %s\n", spec);
+        exit(1);
+    }
+    l->port = port;
+}
+
+// Opens a TCP or UDP socket listening on every address at the port given by spec. A receive_buffer_bytes
+// above 0 sets the socket receive buffer, which is inherited by accepted TCP connections.
+void open_socket_listener(struct socket_listener *l, const char *spec, int receive_buffer_bytes) {
+    struct sockaddr_in addr;
+    int one = 1;
+    int rcvbuf;
+    socklen_t len = sizeof(rcvbuf);
+
+    parse_listen_spec(l, spec);
+    l->connections = 0;
+    l->fd = socket(AF_INET, l->datagram ? SOCK_DGRAM : SOCK_STREAM, 0);
+    less_than_zero_error_check(l->fd, "socket");
+    setsockopt(l->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if(receive_buffer_bytes > 0) {
+        if(receive_buffer_bytes > MAX_RECEIVE_BUFFER_BYTES) {
+            printf("error: receive buffer must be at most %d bytes\n", MAX_RECEIVE_BUFFER_BYTES);
+            exit(0);
+        }
+        less_than_zero_error_check(setsockopt(l->fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer_bytes,
+                                              sizeof(receive_buffer_bytes)), "setsockopt SO_RCVBUF");
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(l->port);
+    less_than_zero_error_check(bind(l->fd, (struct sockaddr *)&addr, sizeof(addr)), "bind");
+    if(!l->datagram) {
+        less_than_zero_error_check(listen(l->fd, LISTEN_BACKLOG), "listen");
+    }
+
+    // The kernel doubles the size it is given for its own bookkeeping
+    getsockopt(l->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &len);
+    printf("Listening on %s port %d, receive buffer %d bytes\n", l->datagram ? "UDP" : "TCP", l->port, rcvbuf);
+}
+
+// Waits for the next TCP connection, or for the first datagram of the next UDP transmission. Returns the
+// input to transmit, or NULL once ctrl + c is pressed. A connection or datagram that cannot be taken, e.g.
+// when out of file descriptors, is logged and the listener keeps waiting.
+FILE *accept_socket_input(struct socket_listener *l) {
+    struct pollfd pfd = { .fd = l->fd, .events = POLLIN };
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd;
+    int ret;
+    FILE *fp;
+
+    printf("\nWaiting for %s, press ctrl+c to stop\n", l->datagram ? "datagrams" : "a connection");
+    while(running) {
+        ret = poll(&pfd, 1, STREAM_WAIT_MS);
+        if(ret < 0 && errno != EINTR) {
+            printf("error: poll on socket failed\n");
+            exit(0);
+        }
+        if(ret <= 0) {
+            continue;
+        }
+        if(l->datagram) {
+            // Peek at the sender, the datagram itself is read as transmission data
+            ret = recvfrom(l->fd, NULL, 0, MSG_PEEK, (struct sockaddr *)&addr, &len);
+            fd = ret < 0 ? -1 : dup(l->fd);
+        } else {
+            fd = accept(l->fd, (struct sockaddr *)&addr, &len);
+        }
+        if(fd < 0) {
+            if(errno != EINTR && errno != ECONNABORTED) {
+                printf("error: %s failed (%s), still listening\n", l->datagram ? "recvfrom" : "accept", strerror(errno));
+                poll(NULL, 0, STREAM_WAIT_MS);      // Back off, the error may last until a connection closes
+            }
+            continue;
+        }
+        fp = fdopen(fd, "rb");
+        null_error_check(fp, "fdopen");
+        l->connections++;
+        snprintf(l->peer, sizeof(l->peer), "%s:%d", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+        printf("Connection %d from %s\n", l->connections, l->peer);
+        l->start_ms = monotonic_ms();
+        return fp;
+    }
+    return NULL;
+}
+
+// Closes a connection once it has been transmitted and prints its throughput
+void close_socket_input(struct socket_listener *l, FILE *fp, off_t num_bytes) {
+    double seconds = (monotonic_ms() - l->start_ms) / 1000.0;
+
+    fclose(fp);
+    printf("Connection %d from %s: received %lld bytes in %.2f s, %.1f kB/s\n", l->connections, l->peer,
+           (long long)num_bytes, seconds, seconds > 0 ? num_bytes / 1024.0 / seconds : 0.0);
+}
+
+// Stops listening
+void close_socket_listener(struct socket_listener *l) {
+    close(l->fd);
+}
@@ -0,0 +1,29 @@
+#ifndef SOCKET_INPUT_H
+#define SOCKET_INPUT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Socket input configuration
+#define MAX_RECEIVE_BUFFER_BYTES (64 * 1024 * 1024)
+#define LISTEN_BACKLOG 4
+
+// A TCP or UDP port transmission data is received on. Every TCP connection is transmitted on its own,
+// UDP datagrams are transmitted until an empty datagram ends the transmission.
+struct socket_listener {
+    int fd;
+    bool datagram;                  // UDP rather than TCP
+    int port;
+    int connections;                // Connections (or UDP transmissions) received so far
+    char peer[64];                  // Address of the current connection
+    long long start_ms;             // When the current connection was received
+};
+
+// Function prototypes
+void open_socket_listener(struct socket_listener *l, const char *spec, int receive_buffer_bytes);
+FILE *accept_socket_input(struct socket_listener *l);
+void close_socket_input(struct socket_listener *l, FILE *fp, off_t num_bytes);
+void close_socket_listener(struct socket_listener *l);
+
+#endif /* SOCKET_INPUT_H */
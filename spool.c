@@ -0,0 +1,179 @@
+/* Spool directory batch transmission for MARLIN SDR */
+
+#include <errno.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include "transmitter.h"
+
+// Order in which waiting files are transmitted
+static enum spool_order spool_order = SPOOL_ORDER_NAME;
+
+// Sets the order in which waiting files are transmitted from a policy name. Exits if it is unknown.
+void set_spool_order(const char *policy) {
+    if(strcmp(policy, "name") == 0) {
+        spool_order = SPOOL_ORDER_NAME;
+    } else if(strcmp(policy, "mtime") == 0) {
+        spool_order = SPOOL_ORDER_MTIME;
+    } else if(strcmp(policy, "size") == 0) {
+        spool_order = SPOOL_ORDER_SIZE;
+    } else {
+        printf("error: spool order must be name, mtime or size, got %s\n", policy);
+        exit(1);
+    }
+}
+
+// Compares two waiting files by the spool order, ties are broken by name
+static int compare_spool_files(const void *a, const void *b) {
+    const struct spool_file *fa = a, *fb = b;
+
+    if(spool_order == SPOOL_ORDER_MTIME && fa->mtime != fb->mtime) {
+        return fa->mtime < fb->mtime ? -1 : 1;
+    }
+    if(spool_order == SPOOL_ORDER_SIZE && fa->size != fb->size) {
+        return fa->size < fb->size ? -1 : 1;
+    }
+    return strcmp(fa->name, fb->name);
+}
+
+// Adds a file to the waiting files unless it is hidden, not a regular file or already waiting
+static void add_spool_file(struct spool *s, const char *name) {
+    char path[MAX_PATH_LENGTH];
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s", s->dir, name);
+    if(name[0] == '.' || strlen(name) > NAME_MAX || stat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return;
+    }
+    for(int n = 0; n < s->num_files; n++) {
+        if(strcmp(s->files[n].name, name) == 0) {
+            return;
+        }
+    }
+    if(s->num_files == s->max_files) {
+        s->max_files = s->max_files ? 2 * s->max_files : 16;
+        s->files = realloc(s->files, s->max_files * sizeof(*s->files));
+        null_error_check((void *)s->files, "spool files");
+    }
+    strcpy(s->files[s->num_files].name, name);
+    s->files[s->num_files].mtime = st.st_mtime;
+    s->files[s->num_files].size = st.st_size;
+    s->num_files++;
+}
+
+// Adds the files named by the inotify events waiting on the spool, without blocking
+static void read_spool_events(struct spool *s) {
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event;
+    ssize_t nbytes;
+
+    while((nbytes = read(s->inotify_fd, events, sizeof(events))) > 0) {
+        for(char *p = events; p < events + nbytes; p += sizeof(*event) + event->len) {
+            event = (const struct inotify_event *)p;
+            if(event->mask & IN_Q_OVERFLOW) {
+                printf("warning: spool events were lost, files written meanwhile need to be moved in again\n");
+            } else if(event->len > 0) {
+                add_spool_file(s, event->name);
+            }
+        }
+    }
+}
+
+// Creates a subdirectory of the spool unless it exists
+static void make_spool_dir(struct spool *s, const char *subdir) {
+    char path[MAX_PATH_LENGTH];
+
+    snprintf(path, sizeof(path), "%s/%s", s->dir, subdir);
+    if(mkdir(path, 0755) < 0 && errno != EEXIST) {
+        printf("error: could not create %s\n", path);
+        exit(0);
+    }
+}
+
+// Starts watching a spool directory. Files already in it are waiting to be transmitted.
+void open_spool(struct spool *s, const char *dir) {
+    struct dirent *entry;
+    DIR *d;
+
+    s->dir = dir;
+    s->files = NULL;
+    s->num_files = s->max_files = 0;
+    s->num_done = s->num_failed = 0;
+    make_spool_dir(s, SPOOL_DONE_DIR);
+    make_spool_dir(s, SPOOL_FAILED_DIR);
+
+    // Watch before listing the directory so no file written in between is missed
+    s->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    less_than_zero_error_check(s->inotify_fd, "inotify_init1");
+    if(inotify_add_watch(s->inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        printf("error: could not watch spool directory %s\n", dir);
+        exit(0);
+    }
+    d = opendir(dir);
+    null_error_check((void *)d, "opendir");
+    while((entry = readdir(d)) != NULL) {
+        add_spool_file(s, entry->d_name);
+    }
+    closedir(d);
+    printf("Spooling from %s, %d files waiting\n", dir, s->num_files);
+}
+
+// Waits for the next file to transmit and opens it. Files written while another one was transmitted
+// are picked up without waiting. Copies the name of the file into name and returns it, or returns NULL
+// once ctrl + c is pressed.
+FILE *next_spool_file(struct spool *s, char *name) {
+    struct pollfd pfd = { .fd = s->inotify_fd, .events = POLLIN };
+    char path[MAX_PATH_LENGTH];
+    bool waiting = false;
+    FILE *fp;
+
+    while(running) {
+        read_spool_events(s);
+        if(s->num_files == 0) {
+            if(!waiting) {
+                printf("\nWaiting for files in %s, press ctrl+c to stop\n", s->dir);
+                waiting = true;
+            }
+            poll(&pfd, 1, STREAM_WAIT_MS);
+            continue;
+        }
+
+        // Take the first waiting file in spool order
+        qsort(s->files, s->num_files, sizeof(*s->files), compare_spool_files);
+        strcpy(name, s->files[0].name);
+        memmove(s->files, s->files + 1, --s->num_files * sizeof(*s->files));
+
+        snprintf(path, sizeof(path), "%s/%s", s->dir, name);
+        fp = fopen(path, "rb");
+        if(fp) {
+            printf("\nTransmitting %s (%d more waiting)\n", path, s->num_files);
+            return fp;
+        }
+        printf("Could not open %s\n", path);
+        finish_spool_file(s, name, false);
+    }
+    return NULL;
+}
+
+// Moves a file out of the spool into the done or failed subdirectory
+void finish_spool_file(struct spool *s, const char *name, bool ok) {
+    char path[MAX_PATH_LENGTH], finished_path[MAX_PATH_LENGTH];
+
+    snprintf(path, sizeof(path), "%s/%s", s->dir, name);
+    snprintf(finished_path, sizeof(finished_path), "%s/%s/%s", s->dir, ok ? SPOOL_DONE_DIR : SPOOL_FAILED_DIR, name);
+    if(rename(path, finished_path) < 0) {
+        printf("warning: could not move %s to %s\n", path, finished_path);
+    }
+    if(ok) {
+        s->num_done++;
+    } else {
+        s->num_failed++;
+    }
+}
+
+// Stops watching the spool directory. Files still waiting are left in it for the next run.
+void close_spool(struct spool *s) {
+    printf("Spool: %d files transmitted, %d failed, %d left waiting\n", s->num_done, s->num_failed, s->num_files);
+    close(s->inotify_fd);
+    free(s->files);
+}
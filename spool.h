@@ -0,0 +1,48 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/types.h>
+
+// Spool directory configuration. Files are moved into these subdirectories of the spool once handled.
+#define SPOOL_DONE_DIR "done"
+#define SPOOL_FAILED_DIR "failed"
+
+// Order in which waiting files are transmitted
+enum spool_order {
+    SPOOL_ORDER_NAME,       // By file name
+    SPOOL_ORDER_MTIME,      // Oldest first
+    SPOOL_ORDER_SIZE        // Smallest first
+};
+
+// A file waiting in the spool directory
+struct spool_file {
+    char name[NAME_MAX + 1];
+    time_t mtime;
+    off_t size;
+};
+
+// A directory watched with inotify. Files already in it are transmitted first, then every file written
+// (closed after writing) or moved into it. Hidden files are skipped, so uploads can use a temporary
+// .name until they are complete.
+struct spool {
+    const char *dir;
+    int inotify_fd;
+    struct spool_file *files;   // Waiting to be transmitted
+    int num_files;
+    int max_files;
+    int num_done;
+    int num_failed;
+};
+
+// Function prototypes
+void set_spool_order(const char *policy);
+void open_spool(struct spool *s, const char *dir);
+FILE *next_spool_file(struct spool *s, char *name);
+void finish_spool_file(struct spool *s, const char *name, bool ok);
+void close_spool(struct spool *s);
+
+#endif /* SPOOL_H */
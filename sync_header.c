@@ -0,0 +1,270 @@
+/* Configurable preamble and sync word for MARLIN SDR */
+
+#include "transmitter.h"
+
+// Barker codes, + for chip 0 and - for chip 1 (the BPSK symbols of bits 0 and 1)
+static const char *barker_codes[] = {
+    [2] = "+-", [3] = "++-", [4] = "++-+", [5] = "+++-+", [7] = "+++--+-", [11] = "+++---+--+-", [13] = "+++++--++-+-+"
+};
+#define MAX_BARKER_LENGTH 13
+
+// Feedback masks of Galois LFSRs that give maximal length sequences, by order
+static const uint32_t mseq_masks[MAX_MSEQ_ORDER + 1] = {
+    [2] = 0x3, [3] = 0x6, [4] = 0xC, [5] = 0x14, [6] = 0x30, [7] = 0x60,
+    [8] = 0xB8, [9] = 0x110, [10] = 0x240, [11] = 0x500, [12] = 0xE08
+};
+
+// Configured preamble and sync word, set up from the defaults on first use if not given
+static struct sync_part preamble;
+static struct sync_part sync_word;
+
+// One period of a sequence being parsed, and the bytes of a header modulated in one piece
+static unsigned char period_values[MAX_SYNC_HEADER_SAMPLES];
+static uint32_t period_samples[MAX_SYNC_HEADER_SAMPLES];
+static unsigned char header_bytes[MAX_SYNC_HEADER_SAMPLES];
+
+// Prints why a preamble or sync word is invalid and exits
+static void sync_part_error(const char *name, const char *spec, const char *reason) {
+    printf("error: invalid %s %s, %s\n", name, spec, reason);
+    exit(0);
+}
+
+// Returns the value of a hex digit, or -1 if it is not one
+static int hex_digit(char digit) {
+    if(digit >= '0' && digit <= '9') {
+        return digit - '0';
+    }
+    if(digit >= 'a' && digit <= 'f') {
+        return digit - 'a' + 10;
+    }
+    if(digit >= 'A' && digit <= 'F') {
+        return digit - 'A' + 10;
+    }
+    return -1;
+}
+
+// Returns the greatest common divisor of two numbers
+static int gcd(int a, int b) {
+    while(b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// Writes the Zadoff-Chu sequence of an odd length and root into period_samples. The phase index
+// root * n * (n + 1) is reduced modulo 2 * length first, so long sequences keep their precision.
+static void build_zadoff_chu(int length, int root) {
+    double amplitude = CONSTELLATION_AMPLITUDE * M_SQRT2;     // Outer ring of the APSK constellations
+    for(int n = 0; n < length; n++) {
+        long long index = (long long)root * n % (2 * length) * (n + 1) % (2 * length);
+        double phase = -M_PI * index / length;
+        period_samples[n] = PACK_IQ(lround(amplitude * cos(phase)), lround(amplitude * sin(phase)));
+    }
+}
+
+// Parses one period of a sequence into period_values or period_samples. Returns its length, exits if the
+// sequence is invalid.
+static size_t parse_sequence(const char *name, const char *spec, const char *sequence, enum sync_part_type *type) {
+    int length, root = 1, used = 0;
+    size_t num_digits;
+
+    if(strcmp(sequence, "none") == 0) {
+        *type = SYNC_PART_BYTES;
+        return 0;
+    }
+    if(strncmp(sequence, "0x", 2) == 0) {
+        *type = SYNC_PART_BYTES;
+        sequence += 2;
+        num_digits = strlen(sequence);
+        if(num_digits == 0 || num_digits % 2 != 0 || num_digits / 2 > MAX_SYNC_HEADER_SAMPLES) {
+            sync_part_error(name, spec, "hex bytes need an even number of digits");
+        }
+        for(size_t n = 0; n < num_digits / 2; n++) {
+            int high = hex_digit(sequence[2 * n]), low = hex_digit(sequence[2 * n + 1]);
+            if(high < 0 || low < 0) {
+                sync_part_error(name, spec, "not a hex number");
+            }
+            period_values[n] = (unsigned char)(high << 4 | low);
+        }
+        return num_digits / 2;
+    }
+    if(sscanf(sequence, "barker%d%n", &length, &used) == 1 && sequence[used] == '\0') {
+        *type = SYNC_PART_CHIPS;
+        if(length < 2 || length > MAX_BARKER_LENGTH || barker_codes[length] == NULL) {
+            sync_part_error(name, spec, "Barker codes have a length of 2, 3, 4, 5, 7, 11 or 13");
+        }
+        for(int n = 0; n < length; n++) {
+            period_values[n] = barker_codes[length][n] == '-';
+        }
+        return length;
+    }
+    if(sscanf(sequence, "mseq%d%n", &length, &used) == 1 && sequence[used] == '\0') {
+        uint32_t state = 1;
+        *type = SYNC_PART_CHIPS;
+        if(length < 2 || length > MAX_MSEQ_ORDER) {
+            sync_part_error(name, spec, "maximal length sequences have an order of 2 to 12");
+        }
+        for(int n = 0; n < (1 << length) - 1; n++) {
+            period_values[n] = state & 1;
+            state = (state >> 1) ^ ((state & 1) ? mseq_masks[length] : 0);
+        }
+        return (1 << length) - 1;
+    }
+    if((sscanf(sequence, "zc%d%n", &length, &used) == 1 && sequence[used] == '\0') ||
+       (sscanf(sequence, "zc%d:%d%n", &length, &root, &used) == 2 && sequence[used] == '\0')) {
+        *type = SYNC_PART_SAMPLES;
+        if(length < 3 || length % 2 == 0 || length > MAX_SYNC_HEADER_SAMPLES) {
+            sync_part_error(name, spec, "Zadoff-Chu sequences need an odd length");
+        }
+        if(root < 1 || root >= length || gcd(root, length) != 1) {
+            sync_part_error(name, spec, "the Zadoff-Chu root must be coprime with the length");
+        }
+        build_zadoff_chu(length, root);
+        return length;
+    }
+    sync_part_error(name, spec, "see -h for the sequences");
+    return 0;
+}
+
+// Returns the most samples a preamble or sync word can take, with one bit per symbol for bytes
+static size_t most_part_samples(const struct sync_part *part) {
+    return part->type == SYNC_PART_BYTES ? part->length * 8 : part->length;
+}
+
+// Parses a preamble or sync word spec, a sequence optionally followed by *<count>, and writes out its repeats.
+// Exits if it is invalid or the header gets longer than MAX_SYNC_HEADER_SAMPLES.
+static void parse_sync_part(struct sync_part *part, const struct sync_part *other, const char *name, const char *spec) {
+    char *sequence;
+    const char *star = strchr(spec, '*');
+    unsigned long repeats = 1;
+    size_t length;
+    char *end;
+
+    if(star == NULL) {
+        star = spec + strlen(spec);
+    } else {
+        repeats = strtoul(star + 1, &end, 10);
+        if(star[1] == '\0' || *end != '\0' || repeats < 1 || repeats > MAX_SYNC_HEADER_SAMPLES) {
+            sync_part_error(name, spec, "the repeat count must be a positive number");
+        }
+    }
+    sequence = strndup(spec, star - spec);
+    null_error_check((void *)sequence, "sequence");
+
+    free(part->values);
+    free(part->samples);
+    memset(part, 0, sizeof(*part));
+    part->spec = spec;
+    length = parse_sequence(name, spec, sequence, &part->type);
+    free(sequence);
+    part->length = length * repeats;
+    if(most_part_samples(part) + most_part_samples(other) > MAX_SYNC_HEADER_SAMPLES) {
+        printf("error: preamble and sync word are longer than %d samples\n", MAX_SYNC_HEADER_SAMPLES);
+        exit(0);
+    }
+
+    if(part->type == SYNC_PART_SAMPLES) {
+        part->samples = malloc(part->length * sizeof(uint32_t));
+        null_error_check((void *)part->samples, "sync samples");
+        for(size_t n = 0; n < part->length; n += length) {
+            memcpy(part->samples + n, period_samples, length * sizeof(uint32_t));
+        }
+    } else if(part->length > 0) {
+        part->values = malloc(part->length);
+        null_error_check((void *)part->values, "sync values");
+        for(size_t n = 0; n < part->length; n += length) {
+            memcpy(part->values + n, period_values, length);
+        }
+    }
+    clear_header_samples();     // Cached headers are rebuilt with the new sequence
+}
+
+// Sets up the default preamble and sync word where none was given
+static void set_up_default_sync_parts() {
+    if(preamble.spec == NULL) {
+        set_preamble(DEFAULT_PREAMBLE);
+    }
+    if(sync_word.spec == NULL) {
+        set_sync_word(DEFAULT_SYNC_WORD);
+    }
+}
+
+// Sets the preamble sent at the start of every frame. Exits if it is invalid.
+void set_preamble(const char *spec) {
+    parse_sync_part(&preamble, &sync_word, "preamble", spec);
+}
+
+// Sets the sync word sent after the preamble of every frame. Exits if it is invalid or empty.
+void set_sync_word(const char *spec) {
+    parse_sync_part(&sync_word, &preamble, "sync word", spec);
+    if(sync_word.length == 0) {
+        sync_part_error("sync word", spec, "a sync word is needed to find the frame header");
+    }
+}
+
+// Returns the preamble spec
+const char *get_preamble_spec() {
+    set_up_default_sync_parts();
+    return preamble.spec;
+}
+
+// Returns the sync word spec
+const char *get_sync_word_spec() {
+    set_up_default_sync_parts();
+    return sync_word.spec;
+}
+
+// Returns true if the preamble and sync word are both bytes. They are then modulated in one piece like a single
+// byte header, so a symbol may hold the end of the preamble and the start of the sync word.
+static bool sync_header_is_bytes() {
+    return preamble.type == SYNC_PART_BYTES && sync_word.type == SYNC_PART_BYTES;
+}
+
+// Returns the number of samples of a preamble or sync word modulated with a constellation
+static size_t sync_part_samples(const struct constellation *c, const struct sync_part *part) {
+    return part->type == SYNC_PART_BYTES ? constellation_symbols(c, part->length) : part->length;
+}
+
+// Returns the number of samples of the preamble and sync word modulated with a constellation
+size_t sync_header_samples(const struct constellation *c) {
+    set_up_default_sync_parts();
+    if(sync_header_is_bytes()) {
+        return constellation_symbols(c, preamble.length + sync_word.length);
+    }
+    return sync_part_samples(c, &preamble) + sync_part_samples(c, &sync_word);
+}
+
+// Writes the samples of a preamble or sync word modulated with a constellation. Returns the number of samples.
+static size_t build_sync_part(const struct constellation *c, const struct sync_part *part, uint32_t *samples) {
+    const struct constellation *bpsk = get_constellation(MOD_BPSK);
+
+    switch(part->type) {
+        case SYNC_PART_BYTES:
+            return map_bytes(c, part->values, part->length, samples);
+        case SYNC_PART_CHIPS:
+            for(size_t n = 0; n < part->length; n++) {
+                samples[n] = bpsk->symbol_table[part->values[n]];
+            }
+            return part->length;
+        default:
+            memcpy(samples, part->samples, part->length * sizeof(uint32_t));
+            return part->length;
+    }
+}
+
+// Writes the samples of the preamble and sync word modulated with a constellation, sync_header_samples long.
+// Returns the number of samples.
+size_t build_sync_header(const struct constellation *c, uint32_t *samples) {
+    size_t num_samples;
+
+    set_up_default_sync_parts();
+    if(sync_header_is_bytes()) {
+        memcpy(header_bytes, preamble.values, preamble.length);
+        memcpy(header_bytes + preamble.length, sync_word.values, sync_word.length);
+        return map_bytes(c, header_bytes, preamble.length + sync_word.length, samples);
+    }
+    num_samples = build_sync_part(c, &preamble, samples);
+    return num_samples + build_sync_part(c, &sync_word, samples + num_samples);
+}
@@ -0,0 +1,45 @@
+#ifndef SYNC_HEADER_H
+#define SYNC_HEADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "modulation.h"
+
+// Preamble and sync word configuration. Both are given as a sequence, optionally repeated with *<count>:
+//   0x<hex>         bytes modulated with the data modulation, e.g. the default preamble 0x33*18
+//   barker<length>  Barker code of length 2, 3, 4, 5, 7, 11 or 13, sent as BPSK chips
+//   mseq<order>     maximal length sequence of 2^order - 1 chips from an LFSR, order 2 to 12, sent as BPSK chips
+//   zc<length>[:<root>]  Zadoff-Chu sequence of odd length, constant amplitude IQ samples (default root 1)
+//   none            no preamble
+// Chips and Zadoff-Chu samples are the same for every modulation, bytes are modulated like the data.
+#define DEFAULT_PREAMBLE "0x33*18"
+#define DEFAULT_SYNC_WORD "0x33F7"
+#define MAX_SYNC_HEADER_SAMPLES 8192    // Most samples of the preamble and sync word together
+#define MAX_MSEQ_ORDER 12
+
+// Kinds of preamble and sync word sequences
+enum sync_part_type {
+    SYNC_PART_BYTES,        // Modulated with the data modulation
+    SYNC_PART_CHIPS,        // One BPSK symbol per chip
+    SYNC_PART_SAMPLES       // IQ samples, independent of the modulation
+};
+
+// A preamble or sync word, with its repeats written out
+struct sync_part {
+    const char *spec;
+    enum sync_part_type type;
+    size_t length;              // Bytes, chips or samples
+    unsigned char *values;      // Bytes, or chips as 0's and 1's
+    uint32_t *samples;
+};
+
+// Function prototypes
+void set_preamble(const char *spec);
+void set_sync_word(const char *spec);
+const char *get_preamble_spec();
+const char *get_sync_word_spec();
+size_t sync_header_samples(const struct constellation *c);
+size_t build_sync_header(const struct constellation *c, uint32_t *samples);
+
+#endif /* SYNC_HEADER_H */
@@ -8,24 +8,43 @@ static struct iio_device *ad9361 = NULL;
 static struct iio_device *tx = NULL;
 static struct iio_channel *tx_i = NULL;
 static struct iio_channel *tx_q = NULL;
-static struct iio_buffer *tx_buf = NULL;
+
+// Command line options
+static char *record_path = NULL;
+static char *context_uri = NULL;
+static bool event_loop_mode = false;
+static bool realtime_mode = false;
+static int modulation_threads = 1;
+static enum input_mode input_mode = INPUT_STDIO;
+static char *input_path = NULL;                 // Transmitted without the menu if given, "-" for stdin
+static char *modulation_name = "QPSK";          // Modulation used for input_path and listen_spec
+static char *listen_spec = NULL;                // [tcp:|udp:]port transmitted from if given
+static int receive_buffer_bytes = 0;            // Socket receive buffer, 0 keeps the system default
+static bool iq_playback = false;                // input_path and spool files hold pre-modulated IQ samples
+static char *spool_dir = NULL;                  // Directory whose files are transmitted as they arrive if given
+static bool benchmark_mode = false;             // Run the microbenchmarks and exit
+static long long transmit_start_ms;
 
 // Global running flag
-int running = true;
+volatile int running = true;
 
 // Handles SIGINT
 void handle_sig() {
     printf("\n");
     running = false;
+    wake_event_loop();
 }
 
 // Cleans up IIO structures on shutdown
-void shutdown() {
+void shut_down_transmitter() {
     printf("\nShutting down program\n");
-    iio_buffer_destroy(tx_buf);
+    shut_down_event_loop();
+    shut_down_modulation_threads();
+    shut_down_tx_backend();
     if(tx_i) { iio_channel_disable(tx_i); }
     if(tx_q) { iio_channel_disable(tx_q); }
-    iio_context_destroy(adalm_pluto);
+    if(adalm_pluto) { iio_context_destroy(adalm_pluto); }
+    clear_header_samples();
 }
 
 // Prints a start message to stdout
@@ -39,6 +58,7 @@ void print_start_message() {
     printf("Transmitter settings:\n");
     printf("- center frequency = %lld Hz\n", TX_LO);
     printf("- bandwidth = %lld Hz\n", TX_BANDWIDTH);
+    printf("- preamble = %s, sync word = %s\n", get_preamble_spec(), get_sync_word_spec());
 }
 
 // Prints a line seperator to stdout
@@ -62,10 +82,46 @@ void less_than_zero_error_check(int val, char *descr) {
     }
 }
 
-// Sets up context (ADALM-PLUTO)
+// Returns the next number, 0 to 65535, of a linear congruential generator. The same starting state gives
+// the same numbers, so the self-checks and benchmarks run on the same data every time.
+uint32_t next_pseudo_random(uint32_t *state) {
+    *state = *state * 1103515245 + 12345;
+    return *state >> 16;
+}
+
+// Fills data with num_bytes bytes from next_pseudo_random
+void fill_pseudo_random(unsigned char *data, size_t num_bytes, uint32_t *state) {
+    for(size_t n = 0; n < num_bytes; n++) {
+        data[n] = (unsigned char)next_pseudo_random(state);
+    }
+}
+
+// Returns a local context if the transmitter is running on the ADALM-PLUTO itself, otherwise NULL.
+// The local backend talks to the kernel drivers directly and streams through the mmap'd DMA block
+// interface, instead of going through iiod's TCP stack like the network backend does.
+struct iio_context *create_local_context() {
+    struct iio_context *ctx = iio_create_local_context();
+    if(ctx && iio_context_find_device(ctx, "ad9361-phy") == NULL) {
+        iio_context_destroy(ctx);
+        ctx = NULL;
+    }
+    return ctx;
+}
+
+// Sets up context (ADALM-PLUTO). Uses the local backend when running on the ADALM-PLUTO, and the
+// network backend (IP_ADDRESS or the -u option) when running on a host.
 void set_up_context() {
     printf("\nSetting up context (ADALM-PLUTO)\n");
-    adalm_pluto = iio_create_context_from_uri(IP_ADDRESS);
+    if(context_uri == NULL) {
+        adalm_pluto = create_local_context();
+        if(adalm_pluto) {
+            printf("Running on ADALM-PLUTO, using local backend\n");
+            return;
+        }
+    }
+    const char *uri = context_uri ? context_uri : IP_ADDRESS;
+    printf("Running on host, using backend %s\n", uri);
+    adalm_pluto = iio_create_context_from_uri(uri);
     null_error_check((void *)adalm_pluto, "Adalm Pluto context");
 }
 
@@ -127,28 +183,81 @@ void enable_streaming_channels() {
 
 // Set up a buffer (tx_buf)
 void set_up_buffer() {
-    printf("Setting up buffer (Tx buffer)\n");
-    tx_buf = iio_device_create_buffer(tx, TEST_TRANSMIT_AMOUNT_BYTES, false); // CYCLIC = FALSE 
-    null_error_check((void *)tx_buf, "tx_buf");
+    printf("Setting up buffer (Tx buffer, %zu samples, %u kernel buffers)\n", get_buffer_samples(), get_kernel_buffers());
+    create_tx_buffer(get_buffer_samples(), false); // CYCLIC = FALSE
+}
+
+// Builds the constellation lookup tables and checks them against the per symbol modulation
+void set_up_modulation_tables() {
+    printf("Setting up modulation tables\n");
+    set_up_constellations();
+    if(verify_constellations() != 0) {
+        printf("error: modulation tables are not bit exact with per symbol modulation\n");
+        exit(0);
+    }
+}
+
+// Builds the CRC-32 lookup tables and checks them against the bit at a time CRC
+void set_up_crc_tables() {
+    printf("Setting up CRC tables\n");
+    set_up_crc32();
+    if(verify_crc32() != 0) {
+        printf("error: CRC tables are not bit exact with the bit at a time CRC\n");
+        exit(0);
+    }
+}
+
+// Builds the convolutional encoder and Reed-Solomon tables and checks the encoders and decoders against each other
+void set_up_fec_tables() {
+    printf("Setting up FEC tables\n");
+    set_up_convolutional_code();
+    if(verify_convolutional_code() != 0) {
+        printf("error: convolutional encoder tables or Viterbi decoders are not bit exact\n");
+        exit(0);
+    }
+    set_up_reed_solomon();
+    if(verify_reed_solomon() != 0) {
+        printf("error: Reed-Solomon tables do not encode codewords or decode errors correctly\n");
+        exit(0);
+    }
 }
 
 // Returns the size of an open file. Assumes file cursor is at beginning of file.
 // Assuming file was opened in binary mode, this function will return size in bytes.
-long get_file_size(FILE *fp) {
+off_t get_file_size(FILE *fp) {
+    struct stat st;
+
     if (fp == NULL) {
         return -1;
     }
-    if (fseek(fp, 0, SEEK_END) < 0) {
-        fclose(fp);
+    if (fstat(fileno(fp), &st) < 0 || !S_ISREG(st.st_mode)) {
+        return -1;      // Pipes, FIFOs, sockets and devices are streamed
+    }
+    if (fseeko(fp, 0, SEEK_END) < 0) {
         return -1;
     }
 
-    long size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    off_t size = ftello(fp);     // 64-bit, files over 2 GB are fine on 32-bit ARM
+    fseeko(fp, 0, SEEK_SET);
 
     return size;
 }
 
+// Prints transmission progress, a progress bar for inputs of known size, otherwise the amount of data
+// transmitted and the throughput since the transmission started
+void print_transmit_progress(off_t progress, off_t total) {
+    double seconds;
+
+    if(total >= 0) {
+        print_progress_bar(progress, total, PROGRESS_BAR_LENGTH);
+        return;
+    }
+    seconds = (monotonic_ms() - transmit_start_ms) / 1000.0;
+    printf("Transmitted %.2f MB, %.1f kB/s    \r", progress / (1024.0 * 1024.0),
+           seconds > 0 ? progress / 1024.0 / seconds : 0.0);
+    fflush(stdout);
+}
+
 // Converts bytes to appropriate unit and prints out result.
 void print_file_size(unsigned long long bytes) {
     double result;
@@ -175,7 +284,7 @@ void print_file_size(unsigned long long bytes) {
 }
 
 // Prints a progress bar
-void print_progress_bar(int progress, int total, int barWidth) {
+void print_progress_bar(off_t progress, off_t total, int barWidth) {
     // Calculate the percentage of progress
     float percentage = (float)progress / total;
     
@@ -210,28 +319,6 @@ int convert_bits_to_binary(int16_t a, int16_t b) {
     return -1; // Default or error value 
 }
 
-// Takes in a bitpair and set the corresponding i and q values.
-void qpsk_modulation(int bitpair, int16_t *i, int16_t *q) {
-    switch(bitpair) {
-        case 0x00:
-            *i = QPSK_00_I;
-            *q = QPSK_00_Q;
-            break;
-        case 0x01:
-            *i = QPSK_01_I;
-            *q = QPSK_01_Q;
-            break;
-        case 0x02:
-            *i = QPSK_10_I;
-            *q = QPSK_10_Q;
-            break;
-        case 0x03:
-            *i = QPSK_11_I;
-            *q = QPSK_11_Q;
-            break;
-    }
-}
-
 // A simple i and q example that prints out i and q values for dummy data
 void qpsk_example() {
     printf("\nQPSK example using a data byte = 00011011.\n");
@@ -245,615 +332,237 @@ void qpsk_example() {
     sleep(LONG_MESSAGE_DELAY);
 }
 
-// A QPSK test that cycles transmitting the four bitpairs. Meant to be viewed on a vector analyzer for testing.
-void qpsk_transmit_test() {
-    printf("\nBeginning QPSK transmission test, press ctrl+c to stop.\n");
-    printf("This test will cycle between sending the four QPSK signals\n");
-    printf("and is meant to be viewed on a vector analyzer for testing.\n\n");
+// A simple 16QAM test that prints out i and q values for dummy data
+void sxtn_qam_example() {
+    printf("\n16QAM example using a data byte = 00011011.\n");
+    printf("\nIn 16QAM, four bits are scanned at a time, and assigned one\n");
+    printf("of sixteen I and Q pairs based on their value. Each I and Q pair\n");
+    printf("represents a phase-shifted signal.\n\n");
+    printf("1st four bits = 0001 -> i = %d, q = %d\n", SXTN_QAM_0001_I, SXTN_QAM_0001_Q);
+    printf("2nd four bits = 1011 -> i = %d, q = %d\n", SXTN_QAM_1011_I, SXTN_QAM_1011_Q);
     sleep(LONG_MESSAGE_DELAY);
-    char *p_dat, *p_end;
-    ptrdiff_t p_inc;
-    ssize_t nbytes_tx;
+}
 
-    while(running) {
-        // Transmit 00
-        printf("Transmitting 00\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = QPSK_00_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = QPSK_00_Q;      // Imag (q)
+// Prompts for a test pattern, and for pattern symbol if a single symbol is selected.
+// Returns the pattern, or -1 if the user chooses to stop the test.
+int prompt_for_test_pattern(const struct constellation *c, int *symbol) {
+    int pattern;
+    char symbol_bits[MAX_PATH_LENGTH];
+    char *end;
+    while(1) {
+        printf("\nPlease enter a number to select test pattern:\n");
+        for(pattern = 0; pattern < NUM_TEST_PATTERNS; pattern++) {
+            printf("         %d - %s\n", pattern + 1, test_pattern_name(pattern));
         }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 01
-        printf("Transmitting 01\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = QPSK_01_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = QPSK_01_Q;      // Imag (q)
+        printf("         %d - Stop test\n\n", NUM_TEST_PATTERNS + 1);
+        pattern = read_number();
+        if(pattern == NUM_TEST_PATTERNS + 1) {
+            return -1;
         }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 10
-        printf("Transmitting 10\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = QPSK_10_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = QPSK_10_Q;      // Imag (q)
+        if(pattern < 1 || pattern > NUM_TEST_PATTERNS) {
+            printf("Invalid selection, please try again.\n");
+            continue;
         }
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        nbytes_tx = iio_buffer_push(tx_buf);
-        if(!running) break;
-
-        // Transmit 11
-        printf("Transmitting 11\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = QPSK_11_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = QPSK_11_Q;      // Imag (q)
+        pattern--;
+        if(pattern != PATTERN_SINGLE_SYMBOL) {
+            return pattern;
         }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
+
+        // Get the symbol for the single symbol pattern
+        printf("\nPlease enter the %d bits of the symbol to transmit (e.g. ", c->bits_per_symbol);
+        for(int bit = 0; bit < c->bits_per_symbol; bit++) {
+            printf("%d", bit & 1);
+        }
+        printf(").\n\n");
+        read_word(symbol_bits);
+        *symbol = (int)strtol(symbol_bits, &end, 2);
+        if(*end == '\0' && (int)strlen(symbol_bits) == c->bits_per_symbol) {
+            return pattern;
+        }
+        printf("Invalid symbol, please try again.\n");
     }
 }
 
-// Transmit data with QPSK modulation scheme. This function continuously transmits packets 
-// until entirity of data has been transmitted. Requires file pointer to open file which contains data to transmit.
-void qpsk_transmit(FILE *transmission_data_fp) {
-    printf("\nBeginning qpsk transmission, press ctrl+c to stop\n\n");
-    char *p_dat;
-    ptrdiff_t p_inc;
+// A transmission test of a constellation meant to be viewed on a vector analyzer for testing. The selected test
+// pattern is built once into a cyclic buffer which the DMA replays without any CPU involvement until another
+// pattern is selected, so only the buffer is recreated when switching patterns.
+void transmit_test(const struct constellation *c) {
+    printf("\nBeginning %s transmission test.\n", c->name);
+    printf("Test patterns are replayed from a cyclic buffer and are\n");
+    printf("meant to be viewed on a vector analyzer for testing.\n");
     ssize_t nbytes_tx;
-    int16_t i, q;
-    int bitpair, bitpairs_filled, bitpairs_remaining, num_bytes_to_read, bytes_read, transmission_data_complete, packet_num;
-    long file_size, total_data_bytes_transmitted;
+    int pattern, symbol = 0;
 
-    // Get file size to determine progress percentages, then print message
-    file_size = get_file_size(transmission_data_fp);
-    print_file_size(file_size);
-    printf("Transmitting...\n");
+    while((pattern = prompt_for_test_pattern(c, &symbol)) >= 0) {
+        // Replace the buffer with a cyclic buffer holding the pattern
+        destroy_tx_buffer();
+        create_tx_buffer(test_pattern_samples(c, pattern), true);
+        build_test_pattern(c, pattern, symbol, tx_buffer_first());
 
-    // Set up local array with preamble 
-    unsigned char preamble[PREAMBLE_SIZE_BYTES] = {
-        0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 
-        0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33
-    };
-
-    // Set up local array with sync word 
-    unsigned char sync_word[SYNC_WORD_SIZE_BYTES] = {
-        0x33, 0xF7
-    };
-
-    // Set up local memory to store file data upon reading file
-    // We will read a maximum of DATA_BYTES_PER_READ bytes at a time
-    unsigned char file_data[DATA_BYTES_PER_READ];
-
-    // Initialize some variables
-    total_data_bytes_transmitted = 0;
-    transmission_data_complete = false;
-    packet_num = 0;
-    
-    // Transmit packets until interrupt occurs or data transmission is complete
-    while(running && !transmission_data_complete) {
-        // Get buffer step sizeand pointer to start of buffer
-        p_inc = iio_buffer_step(tx_buf);
-        p_dat = (char *)iio_buffer_first(tx_buf, tx_i);
-
-        // Fill buffer with preamble, a bitpair at a time
-        for(bitpairs_filled = 0; bitpairs_filled < PREAMBLE_SIZE_BITPAIRS; bitpairs_filled++, p_dat += p_inc) {
-            bitpair = (preamble[bitpairs_filled / 4] >> ((3 - bitpairs_filled % 4) * 2)) & 0b11;
-            qpsk_modulation(bitpair, &i, &q);
-            ((int16_t*)p_dat)[0] = i;
-            ((int16_t*)p_dat)[1] = q;
-        }
+        // Push once, the DMA replays the buffer from here on
+        nbytes_tx = push_tx_buffer();
+        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
+        printf("\nTransmitting %s %s pattern (%zu samples)\n", c->name, test_pattern_name(pattern), tx_buffer_samples());
+    }
 
-        // Fill buffer with sync word, a bitpair at a time
-        for(bitpairs_filled = 0; bitpairs_filled < SYNC_WORD_SIZE_BITPAIRS; bitpairs_filled++, p_dat += p_inc) {
-            bitpair = (sync_word[bitpairs_filled / 4] >> ((3 - bitpairs_filled % 4) * 2)) & 0b11;
-            qpsk_modulation(bitpair, &i, &q);
-            ((int16_t*)p_dat)[0] = i;
-            ((int16_t*)p_dat)[1] = q;
-        }
+    // Go back to the streaming buffer used for data transmission
+    destroy_tx_buffer();
+    set_up_buffer();
+}
 
-        // Fill the rest of the buffer with data, a bitpair at a time
-        bitpairs_filled = 0;
-        bitpairs_remaining = TX_BUFFER_SIZE_BITPAIRS - PREAMBLE_SIZE_BITPAIRS - SYNC_WORD_SIZE_BITPAIRS;
-        while(bitpairs_remaining > 0) {
-            // Determine how many bytes should be read from file
-            num_bytes_to_read = ((bitpairs_remaining / 4) < DATA_BYTES_PER_READ) ? (bitpairs_remaining / 4) : DATA_BYTES_PER_READ;
-
-            // Read bytes from file
-            bytes_read = fread(file_data, 1, num_bytes_to_read, transmission_data_fp);  
-            
-            // Increment total data bytes read
-            total_data_bytes_transmitted += bytes_read;
-
-            // Check if end of transmission data was reached
-            if(bytes_read != num_bytes_to_read) {
-                // TODO: Check for error
-                // Fill packet with remaining data
-                while((bitpairs_filled / 4) < bytes_read) {
-                    bitpair = (file_data[bitpairs_filled / 4] >> ((3 - bitpairs_filled % 4) * 2)) & 0b11;
-                    qpsk_modulation(bitpair, &i, &q);
-                    ((int16_t*)p_dat)[0] = i;
-                    ((int16_t*)p_dat)[1] = q;
-                    bitpairs_filled++;
-                    bitpairs_remaining--;
-                    p_dat += p_inc;  
-                }
-                
-                // Pad rest of packet with 0's
-                while(bitpairs_remaining > 0) {
-                    ((int16_t*)p_dat)[0] = QPSK_00_I;
-                    ((int16_t*)p_dat)[1] = QPSK_00_Q;
-                    p_dat += p_inc;
-                    bitpairs_remaining--;
-                }
+// Transmit data with the modulation scheme of a constellation. This function continuously transmits packets 
+// until entirity of data has been transmitted. Requires file pointer to open file which contains data to transmit.
+// Reading, modulation and pushing run as a pipeline on separate threads (see pipeline.c).
+// Sets num_bytes, unless it is NULL, to the number of bytes read. Returns false if the data could not be
+// opened or read, or a push failed, true if all of it was sent or the transmission was interrupted.
+bool transmit_data(FILE *transmission_data_fp, const struct constellation *c, off_t *num_bytes) {
+    printf("\nBeginning %s transmission, press ctrl+c to stop\n\n", c->name);
+    struct data_input input;
+    struct framer framer;
+    int result = EVENT_LOOP_UNSUPPORTED;
+    bool pushed;
+
+    // Frames of the data are streamed through the transmit buffers, one frame per buffer unless set with -f
+    set_up_framer(&framer, c, tx_buffer_samples());
+    if(get_code_rate() != CODE_RATE_NONE) {
+        printf("Frame payloads are convolutionally coded at rate %s\n", code_rate_name(get_code_rate()));
+    }
+    if(get_rs_block_bytes() != 0) {
+        printf("Frame payloads have the RS(%zu,%zu) outer code\n", get_rs_block_bytes(),
+               get_rs_block_bytes() - RS_PARITY_BYTES);
+    }
+    if(get_frame_bytes() != 0) {
+        printf("Frames of %zu bytes (%zu samples), %zu frames per chunk\n", framer.frame_data_bytes,
+               framer.frame_samples, framer.chunk_data_bytes / framer.frame_data_bytes);
+    }
 
-                // Set flag and break out of loop
-                transmission_data_complete = true;
-                break;
-            }
-
-            // End of transmission data was not reached, so continue to fill the the packet with data
-            while((bitpairs_filled / 4) < bytes_read) {
-                bitpair = (file_data[bitpairs_filled / 4] >> ((3 - bitpairs_filled % 4) * 2)) & 0b11;
-                qpsk_modulation(bitpair, &i, &q);
-                ((int16_t*)p_dat)[0] = i;
-                ((int16_t*)p_dat)[1] = q;
-                bitpairs_filled++;
-                bitpairs_remaining--;
-                p_dat += p_inc;  
-            }
-        }
+    // Get file size to determine progress percentages, then print message
+    if(num_bytes != NULL) {
+        *num_bytes = 0;
+    }
+    if(!open_data_input(&input, transmission_data_fp, input_mode, framer.chunk_data_bytes)) {
+        return false;
+    }
+    if(input.size >= 0) {
+        print_file_size(input.size);
+    }
+    printf("Transmitting...\n");
+    transmit_start_ms = monotonic_ms();
 
-        // Transmit packet and perform error check
-        packet_num++;
-        print_progress_bar(total_data_bytes_transmitted, file_size, PROGRESS_BAR_LENGTH);
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
+    reset_push_stats();
+    if(event_loop_mode) {
+        result = transmit_event_loop(&input, &framer);
+    }
+    if(result == EVENT_LOOP_UNSUPPORTED) {
+        if(event_loop_mode) {
+            printf("Backend does not support non-blocking pushes, falling back to the pipeline\n");
+        }
+        pushed = transmit_pipeline(&input, &framer);
+    } else {
+        pushed = result == 0;
     }
-    printf("\n");   // Needed since print_progress_bar does not print a newline character
-}
-
-// Takes in a fourbit and sets corresponding i and q values.
-void sxtn_qam_modulation(int fourbit, int16_t *i, int16_t *q) {
-    switch(fourbit) {
-        case 0x00:
-            *i = SXTN_QAM_0000_I;
-            *q = SXTN_QAM_0000_Q;
-            break;
-        case 0x01:
-            *i = SXTN_QAM_0001_I;
-            *q = SXTN_QAM_0001_Q;
-            break;
-        case 0x02:
-            *i = SXTN_QAM_0010_I;
-            *q = SXTN_QAM_0010_Q;
-            break;
-        case 0x03:
-            *i = SXTN_QAM_0011_I;
-            *q = SXTN_QAM_0011_Q;
-            break;
-        case 0x04:
-            *i = SXTN_QAM_0100_I;
-            *q = SXTN_QAM_0100_Q;
-            break;
-        case 0x05:
-            *i = SXTN_QAM_0101_I;
-            *q = SXTN_QAM_0101_Q;
-            break;
-        case 0x06:
-            *i = SXTN_QAM_0110_I;
-            *q = SXTN_QAM_0110_Q;
-            break;
-        case 0x07:
-            *i = SXTN_QAM_0111_I;
-            *q = SXTN_QAM_0111_Q;
-            break;
-        case 0x08:
-            *i = SXTN_QAM_1000_I;
-            *q = SXTN_QAM_1000_Q;
-            break;
-        case 0x09:
-            *i = SXTN_QAM_1001_I;
-            *q = SXTN_QAM_1001_Q;
-            break;
-        case 0x0a:
-            *i = SXTN_QAM_1010_I;
-            *q = SXTN_QAM_1010_Q;
-            break;
-        case 0x0b:
-            *i = SXTN_QAM_1011_I;
-            *q = SXTN_QAM_1011_Q;
-            break;
-        case 0x0c:
-            *i = SXTN_QAM_1100_I;
-            *q = SXTN_QAM_1100_Q;
-            break;
-        case 0x0d:
-            *i = SXTN_QAM_1101_I;
-            *q = SXTN_QAM_1101_Q;
-            break;
-        case 0x0e:
-            *i = SXTN_QAM_1110_I;
-            *q = SXTN_QAM_1110_Q;
-            break;
-        case 0x0f:
-            *i = SXTN_QAM_1111_I;
-            *q = SXTN_QAM_1111_Q;
-            break;
+    close_data_input(&input);
+    print_push_stats();
+    if(num_bytes != NULL) {
+        *num_bytes = input.num_bytes;
     }
+    return pushed && !input.error;
 }
 
-// A simple 16QAM test that prints out i and q values for dummy data
-void sxtn_qam_example() {
-    printf("\n16QAM example using a data byte = 00011011.\n");
-    printf("\nIn 16QAM, four bits are scanned at a time, and assigned one\n");
-    printf("of sixteen I and Q pairs based on their value. Each I and Q pair\n");
-    printf("represents a phase-shifted signal.\n\n");
-    printf("1st four bits = 0001 -> i = %d, q = %d\n", SXTN_QAM_0001_I, SXTN_QAM_0001_Q);
-    printf("2nd four bits = 1011 -> i = %d, q = %d\n", SXTN_QAM_1011_I, SXTN_QAM_1011_Q);
-    sleep(LONG_MESSAGE_DELAY);
+// Reads a word typed on the command line interface into word, which holds MAX_PATH_LENGTH characters.
+// Shuts the transmitter down once the input has ended, as nothing more can be typed.
+void read_word(char *word) {
+    char format[16];
+    snprintf(format, sizeof(format), "%%%ds", MAX_PATH_LENGTH - 1);
+    if(scanf(format, word) != 1) {
+        printf("\nEnd of input\n");
+        shut_down_transmitter();
+        exit(0);
+    }
 }
 
-// A 16QAM test that cycles transmitting the sixteen fourbits. Meant to be viewed on a vector analyzer for testing.
-void sxtn_qam_transmit_test() {
-    printf("\nBeginning 16QAM transmission test, press ctrl+c to stop.\n");
-    printf("This test will cycle between sending the sixteen 16QAM signals\n");
-    printf("and is meant to be viewed on a vector analyzer for testing.\n\n");
-    sleep(LONG_MESSAGE_DELAY);
-    char *p_dat, *p_end;
-    ptrdiff_t p_inc;
-    ssize_t nbytes_tx;
+// Reads a number typed on the command line interface. Returns -1 if what was typed is not a number.
+int read_number() {
+    char word[MAX_PATH_LENGTH];
+    char *end;
+    long number;
 
-    while(running) {
-        // Transmit 0000
-        printf("Transmitting 0000\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_0000_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_0000_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 0001
-        printf("Transmitting 0001\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_0001_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_0001_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 0011
-        printf("Transmitting 0011\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_0011_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_0011_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 0010
-        printf("Transmitting 0010\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_0010_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_0010_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 0100
-        printf("Transmitting 0100\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_0100_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_0100_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 0101
-        printf("Transmitting 0101\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_0101_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_0101_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 0111
-        printf("Transmitting 0111\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_0111_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_0111_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 0110
-        printf("Transmitting 0110\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_0110_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_0110_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 1100
-        printf("Transmitting 1100\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_1100_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_1010_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 1101
-        printf("Transmitting 1101\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_1101_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_1101_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 1111
-        printf("Transmitting 1111\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_1111_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_1111_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 1110
-        printf("Transmitting 1110\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_1110_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_1110_Q;      // Imag (q)
-        }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 1000
-        printf("Transmitting 1000\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_1000_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_1000_Q;      // Imag (q)
+    read_word(word);
+    number = strtol(word, &end, 10);
+    if(end == word || *end != '\0' || number < 0 || number > INT_MAX) {
+        return -1;
+    }
+    return (int)number;
+}
+
+// Prompts for the path of a file to transmit until a valid file is opened. Returns NULL if the user types 'exit'.
+FILE *prompt_for_transmission_file() {
+    char file_path[MAX_PATH_LENGTH];
+    FILE *transmission_data_fp;
+    while(1) {
+        printf("\nPlease enter the full path to a file on the ADALM-PLUTO file system that you want to transmit.\n");
+        printf("Max path length is %d characters. If you want to exit back to operation menu, type 'exit'.\n\n", MAX_PATH_LENGTH);
+        read_word(file_path);
+        if(strcmp("exit", file_path) == 0) {
+            return NULL;
         }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 1001
-        printf("Transmitting 1001\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_1001_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_1001_Q;      // Imag (q)
+        // gzip and zlib compressed files are inflated while they are transmitted with -z
+        transmission_data_fp = fopen(file_path, "rb");      // Open file for reading
+        if(transmission_data_fp) {                          // Return if valid file is opened, otherwise print error and prompt again
+            return transmission_data_fp;
         }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 1011
-        printf("Transmitting 1011\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_1011_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_1011_Q;      // Imag (q)
+        printf("\nNo valid file exists at the provided path. Please try again.");
+    }
+}
+
+// Prompts for a pre-modulated IQ file or SigMF dataset until one that can be played back is entered.
+// Returns NULL if the user types 'exit'.
+FILE *prompt_for_iq_file() {
+    char file_path[MAX_PATH_LENGTH];
+    FILE *iq_fp;
+    while(1) {
+        printf("\nPlease enter the full path to an IQ file (interleaved 16-bit little endian I and Q) or a SigMF dataset.\n");
+        printf("Max path length is %d characters. If you want to exit back to operation menu, type 'exit'.\n\n", MAX_PATH_LENGTH);
+        read_word(file_path);
+        if(strcmp("exit", file_path) == 0) {
+            return NULL;
         }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
-        if(!running) break;
-
-        // Transmit 1010
-        printf("Transmitting 1010\r");
-        fflush(stdout);
-        p_inc = iio_buffer_step(tx_buf);
-        p_end = iio_buffer_end(tx_buf);
-        for (p_dat = (char *)iio_buffer_first(tx_buf, tx_i); p_dat < p_end; p_dat += p_inc) {
-            ((int16_t*)p_dat)[0] = SXTN_QAM_1010_I;      // Real (i)
-            ((int16_t*)p_dat)[1] = SXTN_QAM_1010_Q;      // Imag (q)
+        iq_fp = open_iq_file(file_path);
+        if(iq_fp) {
+            return iq_fp;
         }
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
+        printf("\nNo IQ file that can be played back exists at the provided path. Please try again.");
     }
 }
 
-// Transmit data with 16QAM modulation scheme. This function continuously transmits packets 
-// until entirity of data has been transmitted. Requires file pointer to open file which contains data to transmit.
-void sxtn_qam_transmit(FILE *transmission_data_fp) {
-    printf("\nBeginning 16QAM transmission, press ctrl+c to stop\n\n");
-    char *p_dat;
-    ptrdiff_t p_inc;
-    ssize_t nbytes_tx;
-    int16_t i, q;
-    int fourbit, fourbits_filled, fourbits_remaining, num_bytes_to_read, bytes_read, transmission_data_complete, packet_num;
-    long file_size, total_data_bytes_transmitted;
-
-    // Get file size to determine progress percentages, then print message
-    file_size = get_file_size(transmission_data_fp);
-    print_file_size(file_size);
-    printf("Transmitting...\n");
-
-    // Set up local array with preamble 
-    unsigned char preamble[PREAMBLE_SIZE_BYTES] = {
-        0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 
-        0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33
-    };
-
-    // Set up local array with sync word 
-    unsigned char sync_word[SYNC_WORD_SIZE_BYTES] = {
-        0x33, 0xF7
-    };
-
-    // Set up local memory to store file data upon reading file
-    // We will read a maximum of DATA_BYTES_PER_READ bytes at a time
-    unsigned char file_data[DATA_BYTES_PER_READ];
-
-    // Initialize some variables
-    total_data_bytes_transmitted = 0;
-    transmission_data_complete = false;
-    packet_num = 0;
-
-    // Transmit packets until interrupt occurs or data transmission is complete
-    while(running && !transmission_data_complete) {
-        // Get buffer step size and pointer to start of buffer
-        p_inc = iio_buffer_step(tx_buf);
-        p_dat = (char *)iio_buffer_first(tx_buf, tx_i);
-
-        // Fill buffer with preamble, four bits at a time
-        for(fourbits_filled = 0; fourbits_filled < PREAMBLE_SIZE_FOURBITS; fourbits_filled++, p_dat += p_inc) {
-            fourbit = (preamble[fourbits_filled / 2] >> ((1 - (fourbits_filled % 2)) * 4)) & 0b1111;
-            sxtn_qam_modulation(fourbit, &i, &q);
-            ((int16_t*)p_dat)[0] = i;
-            ((int16_t*)p_dat)[1] = q;
+// Prompts for a modulation until a supported one is entered. Returns NULL if the user types 'exit'.
+const struct constellation *prompt_for_constellation() {
+    char name[MAX_PATH_LENGTH];
+    const struct constellation *c;
+    while(1) {
+        printf("\nPlease enter a modulation:");
+        for(int id = 0; id < NUM_MODULATIONS; id++) {
+            printf(" %s", get_constellation(id)->name);
         }
-
-        // Fill buffer with sync word, four bits at a time
-        for(fourbits_filled = 0; fourbits_filled < SYNC_WORD_SIZE_FOURBITS; fourbits_filled++, p_dat += p_inc) {
-            fourbit = (sync_word[fourbits_filled / 2] >> ((1 - (fourbits_filled % 2)) * 4)) & 0b1111;
-            sxtn_qam_modulation(fourbit, &i, &q);
-            ((int16_t*)p_dat)[0] = i;
-            ((int16_t*)p_dat)[1] = q;
+        printf("\nIf you want to exit back to operation menu, type 'exit'.\n\n");
+        read_word(name);
+        if(strcmp("exit", name) == 0) {
+            return NULL;
         }
-
-        // Fill the rest of the buffer with data, four bits at a time
-        fourbits_filled = 0;
-        fourbits_remaining = TX_BUFFER_SIZE_FOURBITS - PREAMBLE_SIZE_FOURBITS - SYNC_WORD_SIZE_FOURBITS;
-        while(fourbits_remaining > 0) {
-            // Determine how many bytes should be read from file
-            num_bytes_to_read = ((fourbits_remaining / 2) < DATA_BYTES_PER_READ) ? (fourbits_remaining / 2) : DATA_BYTES_PER_READ;
-
-            // Read bytes from file
-            bytes_read = fread(file_data, 1, num_bytes_to_read, transmission_data_fp);  
-            
-            // Increment total data bytes read
-            total_data_bytes_transmitted += bytes_read;
-
-            // Check if end of transmission data was reached
-            if(bytes_read != num_bytes_to_read) {
-                // TODO: Check for error
-                // Fill packet with remaining data
-                while((fourbits_filled / 2) < bytes_read) {
-                    fourbit = (file_data[fourbits_filled / 2] >> ((1 - (fourbits_filled % 2)) * 4)) & 0b1111;
-                    sxtn_qam_modulation(fourbit, &i, &q);
-                    ((int16_t*)p_dat)[0] = i;
-                    ((int16_t*)p_dat)[1] = q;
-                    fourbits_filled++;
-                    fourbits_remaining--;
-                    p_dat += p_inc;  
-                }
-                
-                // Pad rest of packet with 0's
-                while(fourbits_remaining > 0) {
-                    ((int16_t*)p_dat)[0] = SXTN_QAM_0000_I;
-                    ((int16_t*)p_dat)[1] = SXTN_QAM_0000_Q;
-                    p_dat += p_inc;
-                    fourbits_remaining--;
-                }
-
-                // Set flag and break out of loop
-                transmission_data_complete = true;
-                break;
-            }
-
-            // End of transmission data was not reached, so continue to fill the the packet with data
-            while((fourbits_filled / 2) < bytes_read) {
-                fourbit = (file_data[fourbits_filled / 2] >> ((1 - (fourbits_filled % 2)) * 4)) & 0b1111;
-                sxtn_qam_modulation(fourbit, &i, &q);
-                ((int16_t*)p_dat)[0] = i;
-                ((int16_t*)p_dat)[1] = q;
-                fourbits_filled++;
-                fourbits_remaining--;
-                p_dat += p_inc;  
-            }
+        c = find_constellation(name);
+        if(c) {
+            return c;
         }
-
-        // Transmit packet and perform error check
-        packet_num++;
-        print_progress_bar(total_data_bytes_transmitted, file_size, PROGRESS_BAR_LENGTH);
-        nbytes_tx = iio_buffer_push(tx_buf);
-        less_than_zero_error_check((int)nbytes_tx, "nbytes_tx");
+        printf("\nUnknown modulation. Please try again.");
     }
-    printf("\n");   // Needed since print_progress_bar does not print a newline character
 }
 
 // Takes in user command to operate transmitter until transmitter is shut down
 void operate_transmitter() {
     int mode;
     int terminate = false;
-    char file_path[MAX_PATH_LENGTH];
     FILE *transmission_data_fp;
+    const struct constellation *c;
     while(!terminate) {
         printf("\nTransmitter operation menu.\n");
         printf("\nPlease enter a number to select transmitter mode:\n \
@@ -863,8 +572,11 @@ void operate_transmitter() {
         4 - 16QAM example\n \
         5 - 16QAM transmission test\n \
         6 - 16QAM transmission of data\n \
-        7 - Shutdown transmitter\n\n");
-        scanf("%d", &mode);
+        7 - Shutdown transmitter\n \
+        8 - Transmission test with another modulation\n \
+        9 - Transmission of data with another modulation\n \
+        10 - Playback of a pre-modulated IQ file\n\n");
+        mode = read_number();
         print_seperator();
         switch(mode) {
             case 1:
@@ -873,29 +585,15 @@ void operate_transmitter() {
                 print_seperator();
                 break;
             case 2:
-                qpsk_transmit_test();         // Transmit test data with qpsk scheme
-                running = true;               // Reset SIGINT interrupt flag
+                transmit_test(get_constellation(MOD_QPSK));     // Transmit test data with qpsk scheme
+                running = true;                                 // Reset SIGINT interrupt flag
                 print_seperator();
                 break;
             case 3:
-                while(1) {
-                    printf("\nPlease enter the full path to a file on the ADALM-PLUTO file system that you want to transmit.\n");
-                    printf("Max path length is %d characters. If you want to exit back to operation menu, type 'exit'.\n\n", MAX_PATH_LENGTH);
-                    scanf("%s", file_path);
-                    if(strcmp("exit", file_path) == 0) {
-                        running = false;
-                        break;
-                    }
-                    // Zip file ???
-                    transmission_data_fp = fopen(file_path, "rb");      // Open file for reading
-                    if(transmission_data_fp) {                          // Break if valid file is opened, otherwise print error and prompt again
-                        break;
-                    }
-                    printf("\nNo valid file exists at the provided path. Please try again.");
-                }
-                if (running) {
-                    qpsk_transmit(transmission_data_fp);                // Transmit data 
-                    fclose(transmission_data_fp);                       // Close file
+                transmission_data_fp = prompt_for_transmission_file();
+                if (transmission_data_fp) {
+                    transmit_data(transmission_data_fp, get_constellation(MOD_QPSK), NULL);     // Transmit data 
+                    fclose(transmission_data_fp);                                               // Close file
                 }
                 running = true;
                 print_seperator();
@@ -906,29 +604,15 @@ void operate_transmitter() {
                 print_seperator();
                 break;
             case 5:
-                sxtn_qam_transmit_test();   // Transmit test data with 16QAM scheme
-                running = true;             // Reset SIGINT interrupt flag
+                transmit_test(get_constellation(MOD_16QAM));    // Transmit test data with 16QAM scheme
+                running = true;                                 // Reset SIGINT interrupt flag
                 print_seperator();
                 break;
             case 6:
-                while(1) {
-                    printf("\nPlease enter the full path to a file on the ADALM-PLUTO file system that you want to transmit.\n");
-                    printf("Max path length is %d characters. If you want to exit back to operation menu, type 'exit'.\n\n", MAX_PATH_LENGTH);
-                    scanf("%s", file_path);
-                    if(strcmp("exit", file_path) == 0) {
-                        running = false;
-                        break;
-                    }
-                    // Zip file ???
-                    transmission_data_fp = fopen(file_path, "rb");      // Open file for reading
-                    if(transmission_data_fp) {                          // Break if valid file is opened, otherwise print error and prompt again
-                        break;
-                    }
-                    printf("\nNo valid file exists at the provided path. Please try again.");
-                }
-                if (running) {
-                    sxtn_qam_transmit(transmission_data_fp);            // Transmit data 
-                    fclose(transmission_data_fp);                       // Close file
+                transmission_data_fp = prompt_for_transmission_file();
+                if (transmission_data_fp) {
+                    transmit_data(transmission_data_fp, get_constellation(MOD_16QAM), NULL);    // Transmit data 
+                    fclose(transmission_data_fp);                                               // Close file
                 }
                 running = true;
                 print_seperator();
@@ -936,33 +620,346 @@ void operate_transmitter() {
             case 7:
                 terminate = true;
                 break;
+            case 8:
+                c = prompt_for_constellation();
+                if (c) {
+                    transmit_test(c);       // Transmit test data with selected scheme
+                }
+                running = true;
+                print_seperator();
+                break;
+            case 9:
+                c = prompt_for_constellation();
+                transmission_data_fp = c ? prompt_for_transmission_file() : NULL;
+                if (transmission_data_fp) {
+                    transmit_data(transmission_data_fp, c, NULL);   // Transmit data 
+                    fclose(transmission_data_fp);                   // Close file
+                }
+                running = true;
+                print_seperator();
+                break;
+            case 10:
+                transmission_data_fp = prompt_for_iq_file();
+                if (transmission_data_fp) {
+                    play_iq_file(transmission_data_fp);         // Stream IQ samples without modulating
+                    fclose(transmission_data_fp);               // Close file
+                }
+                running = true;
+                print_seperator();
+                break;
             default:
                 printf("Invalid selection, please try again.\n");
-                while(getchar() != '\n');       // Clear input buffer
                 break;
         }
     }
 }
 
-int main() {
+// Prints command line usage
+void print_usage(char *program_name) {
+    printf("Usage: %s [options] [file | -]\n", program_name);
+    printf("Transmits file, or standard input for -, without the operation menu. Pipes, FIFOs and\n");
+    printf("other streams of unknown length are transmitted as their data arrives.\n");
+    printf("Options:\n");
+    printf("  -u <uri>    IIO context URI of the ADALM-PLUTO, e.g. ip:192.168.2.1 (default: local backend\n");
+    printf("              when running on the ADALM-PLUTO, otherwise %s)\n", IP_ADDRESS);
+    printf("  -r <file>   Record transmit buffers to a file instead of transmitting (no ADALM-PLUTO needed)\n");
+    printf("  -k <count>  Kernel buffers queued for the DMA, 1 to %d (default: %d)\n", MAX_KERNEL_BUFFERS, DEFAULT_KERNEL_BUFFERS);
+    printf("  -n <count>  Samples per buffer, a multiple of %d from %d to %d (default: %d)\n",
+           BUFFER_SAMPLES_MULTIPLE, MIN_BUFFER_SAMPLES, MAX_BUFFER_SAMPLES, TEST_TRANSMIT_AMOUNT);
+    printf("  -f <bytes>  Payload of each frame, %d to %d bytes, framed independently of the buffers\n", MIN_FRAME_BYTES, MAX_FRAME_BYTES);
+    printf("              (default: one frame per buffer)\n");
+    printf("  -P <seq>    Preamble of each frame (default: %s), a sequence optionally repeated with *<count>:\n", DEFAULT_PREAMBLE);
+    printf("              0x<hex> bytes modulated like the data, barker<2-13> or mseq<order 2-%d> BPSK chips,\n", MAX_MSEQ_ORDER);
+    printf("              zc<odd length>[:<root>] Zadoff-Chu samples, or none\n");
+    printf("  -S <seq>    Sync word of each frame, a sequence like -P (default: %s)\n", DEFAULT_SYNC_WORD);
+    printf("  -F <rate>   Convolutional code rate of the frame payload: none, 1/2, 2/3, 3/4 or 7/8 (default: none)\n");
+    printf("  -O <bytes>  Reed-Solomon outer code of the frame payload with codewords of %d to %d bytes, %d of them\n",
+           MIN_RS_BLOCK_BYTES, RS_SYMBOLS, RS_PARITY_BYTES);
+    printf("              parity: %d for RS(255,223), fewer for a shortened code (default: none)\n", RS_SYMBOLS);
+    printf("  -p <count>  Buffers to modulate before the first push, 0 to %d (default: kernel buffers)\n", PIPELINE_PACKETS);
+    printf("  -w <count>  Threads modulating each packet, 1 to %d (default: 1)\n", MAX_MODULATION_THREADS);
+    printf("  -M          Map the transmission file into memory and modulate straight from the page cache\n");
+    printf("  -A          Read the transmission file with asynchronous direct I/O reads\n");
+    printf("  -z          Inflate gzip or zlib compressed transmission files while transmitting them\n");
+    printf("  -q <count>  Asynchronous reads kept in flight with -A, 1 to %d (default: %d)\n", MAX_AIO_DEPTH, DEFAULT_AIO_DEPTH);
+    printf("  -l <port>   Transmit the data received on a port instead, tcp:<port> (the default) for each TCP\n");
+    printf("              connection in turn or udp:<port> for datagrams, an empty datagram ends a transmission\n");
+    printf("  -b <bytes>  Socket receive buffer size for -l, up to %d (default: system default)\n", MAX_RECEIVE_BUFFER_BYTES);
+    printf("  -I          file holds pre-modulated IQ samples (interleaved 16-bit little endian I and Q, or a\n");
+    printf("              SigMF dataset) that are played back without modulating them\n");
+    printf("  -s <dir>    Transmit every file in a spool directory back to back, then each file written or moved\n");
+    printf("              into it, and move them into its %s or %s subdirectory\n", SPOOL_DONE_DIR, SPOOL_FAILED_DIR);
+    printf("  -o <order>  Order of the waiting spool files: name, mtime (oldest first) or size (smallest first)\n");
+    printf("              (default: name)\n");
+    printf("  -c <name>   Modulation used to transmit file, standard input, -l or -s (default: %s)\n", modulation_name);
+    printf("  -t <ms>     Time a partial packet of a stream waits for more data before it is sent,\n");
+    printf("              1 to %d (default: %d)\n", MAX_STREAM_FLUSH_MS, DEFAULT_STREAM_FLUSH_MS);
+    printf("  -e          Push from a single threaded event loop with non-blocking pushes instead of the\n");
+    printf("              read, modulate and push pipeline\n");
+    printf("  -B          Benchmark the CRC-32, modulation, convolutional and Reed-Solomon coding kernels, then exit\n");
+    printf("  -R          Real-time mode: lock memory and run the push thread with SCHED_FIFO priority on its own core\n");
+    printf("  -h          Print this message\n");
+}
+
+// Sets how transmission files are read, exits if -M, -A and -z are given together
+void set_input_mode(enum input_mode mode) {
+    if(input_mode != INPUT_STDIO && input_mode != mode) {
+        printf("error: only one of -M, -A and -z can be given\n");
+        exit(1);
+    }
+    input_mode = mode;
+}
+
+// Parses a non-negative number given for a command line option, exits if it is not one
+unsigned long parse_count(const char *arg, char option) {
+    char *end;
+    unsigned long count = strtoul(arg, &end, 0);
+    if(*arg == '\0' || *arg == '-' || *end != '\0' || count > INT_MAX) {
+        printf("error: -%c expects a number, got %s\n", option, arg);
+        exit(1);
+    }
+    return count;
+}
+
+// Parses command line options
+void parse_arguments(int argc, char *argv[]) {
+    int option;
+    unsigned long kernel_buffers = DEFAULT_KERNEL_BUFFERS;
+    unsigned long buffer_samples = TEST_TRANSMIT_AMOUNT;
+    long prefill_buffers = -1;      // Follows the kernel buffer count unless given
+    while((option = getopt(argc, argv, "u:r:k:n:f:P:S:F:O:p:w:MAzq:c:t:l:b:Is:o:eRBh")) != -1) {
+        switch(option) {
+            case 'u':
+                context_uri = optarg;
+                break;
+            case 'r':
+                record_path = optarg;
+                break;
+            case 'k':
+                kernel_buffers = parse_count(optarg, option);
+                break;
+            case 'n':
+                buffer_samples = parse_count(optarg, option);
+                break;
+            case 'f':
+                set_frame_bytes(parse_count(optarg, option));
+                break;
+            case 'P':
+                set_preamble(optarg);
+                break;
+            case 'S':
+                set_sync_word(optarg);
+                break;
+            case 'F':
+                set_code_rate(optarg);
+                break;
+            case 'O':
+                set_rs_block_bytes(parse_count(optarg, option));
+                break;
+            case 'p':
+                prefill_buffers = parse_count(optarg, option);
+                break;
+            case 'w':
+                modulation_threads = parse_count(optarg, option);
+                break;
+            case 'M':
+                set_input_mode(INPUT_MMAP);
+                break;
+            case 'A':
+                set_input_mode(INPUT_AIO);
+                break;
+            case 'z':
+                set_input_mode(INPUT_INFLATE);
+                break;
+            case 'q':
+                set_aio_depth(parse_count(optarg, option));
+                break;
+            case 'c':
+                modulation_name = optarg;       // Checked once the constellations are set up
+                break;
+            case 't':
+                set_stream_flush_ms(parse_count(optarg, option));
+                break;
+            case 'I':
+                iq_playback = true;
+                break;
+            case 's':
+                spool_dir = optarg;
+                break;
+            case 'o':
+                set_spool_order(optarg);
+                break;
+            case 'l':
+                listen_spec = optarg;
+                break;
+            case 'b':
+                receive_buffer_bytes = parse_count(optarg, option);
+                break;
+            case 'e':
+                event_loop_mode = true;
+                break;
+            case 'R':
+                realtime_mode = true;
+                break;
+            case 'B':
+                benchmark_mode = true;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                exit(0);
+            default:
+                print_usage(argv[0]);
+                exit(1);
+        }
+    }
+    if(optind < argc) {
+        input_path = argv[optind++];
+    }
+    if(optind < argc) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    if(input_mode == INPUT_INFLATE && (iq_playback || listen_spec != NULL)) {
+        printf("error: -z cannot be used with -I or -l, IQ files and sockets are never inflated\n");
+        exit(1);
+    }
+    if(prefill_buffers < 0) {
+        prefill_buffers = kernel_buffers < PIPELINE_PACKETS ? kernel_buffers : PIPELINE_PACKETS;
+    }
+    set_tx_buffer_config(kernel_buffers, buffer_samples, prefill_buffers);
+}
+
+// Returns the constellation given with -c, or NULL after printing an error if there is none
+const struct constellation *command_line_constellation() {
+    const struct constellation *c = find_constellation(modulation_name);
+    if(c == NULL) {
+        printf("error: unknown modulation %s\n", modulation_name);
+    }
+    return c;
+}
+
+// Transmits the file or standard input given on the command line
+void transmit_input_path() {
+    const struct constellation *c = command_line_constellation();
+    FILE *fp = stdin;
+    if(c == NULL) {
+        return;
+    }
+    if(iq_playback) {
+        fp = open_iq_file(input_path);
+        if(fp == NULL) {
+            printf("error: could not play back %s\n", input_path);
+            return;
+        }
+        play_iq_file(fp);
+        fclose(fp);
+        return;
+    }
+    if(strcmp(input_path, "-") != 0) {
+        fp = fopen(input_path, "rb");
+        if(fp == NULL) {
+            printf("error: could not open %s\n", input_path);
+            return;
+        }
+    }
+    transmit_data(fp, c, NULL);
+    if(fp != stdin) {
+        fclose(fp);
+    }
+}
+
+// Transmits the data received on the port given on the command line until ctrl + c
+void transmit_socket_input() {
+    const struct constellation *c = command_line_constellation();
+    struct socket_listener listener;
+    off_t num_bytes;
+    FILE *fp;
+    if(c == NULL) {
+        return;
+    }
+    open_socket_listener(&listener, listen_spec, receive_buffer_bytes);
+    while((fp = accept_socket_input(&listener)) != NULL) {
+        transmit_data(fp, c, &num_bytes);
+        close_socket_input(&listener, fp, num_bytes);
+    }
+    close_socket_listener(&listener);
+}
+
+// Transmits the files of the spool directory given on the command line as they arrive until ctrl + c.
+// Files follow each other without reopening the IIO context or going through the menu.
+void transmit_spool() {
+    const struct constellation *c = command_line_constellation();
+    char name[NAME_MAX + 1];
+    struct spool spool;
+    FILE *fp;
+    bool ok;
+    if(c == NULL) {
+        return;
+    }
+    open_spool(&spool, spool_dir);
+    while((fp = next_spool_file(&spool, name)) != NULL) {
+        if(iq_playback) {
+            ok = play_iq_file(fp);
+        } else {
+            ok = transmit_data(fp, c, NULL);
+        }
+        fclose(fp);
+        if(running || !ok) {
+            finish_spool_file(&spool, name, ok);
+        }
+        // An interrupted file stays in the spool to be transmitted again on the next run, one that could not
+        // be read or pushed is moved to the failed directory
+    }
+    close_spool(&spool);
+}
+
+int main(int argc, char *argv[]) {
+    parse_arguments(argc, argv);    // Parse command line options
     signal(SIGINT, handle_sig);     // Set up ctrl + c signal interrupt
+    if(benchmark_mode) {
+        set_up_modulation_tables();     // Nothing else is needed to benchmark the kernels
+        set_up_crc_tables();
+        set_up_fec_tables();
+        run_benchmarks();
+        return 0;
+    }
     print_seperator();              // Print a seperator to stdout
     print_start_message();          // Prints start message to console
     print_seperator();              // Print a seperator to stdout
     sleep(SHORT_MESSAGE_DELAY);     // Delay between CLI messages
-    set_up_context();               // Set up context (ADALM-PLUTO)
-    set_up_device();                // Set up device (AD9361 Physical Layer)
-    config_device();                // Configure device (AD9361 Physical Layer)
-    set_up_device_2();              // Set up device 2 (AD9361 Tx Output Driver)
-    set_up_streaming_channels();    // Set up streaming channels (tx_i and tx_q)
-    enable_streaming_channels();    // Enable streaming channels (tx_i and tx_q)
+    if(record_path == NULL) {
+        set_up_context();               // Set up context (ADALM-PLUTO)
+        set_up_device();                // Set up device (AD9361 Physical Layer)
+        config_device();                // Configure device (AD9361 Physical Layer)
+        set_up_device_2();              // Set up device 2 (AD9361 Tx Output Driver)
+        set_up_streaming_channels();    // Set up streaming channels (tx_i and tx_q)
+        enable_streaming_channels();    // Enable streaming channels (tx_i and tx_q)
+        set_up_tx_backend_iio(tx, tx_i);        // Transmit buffers with the Tx output driver
+    } else {
+        set_up_tx_backend_record(record_path);  // Record buffers to a file instead of transmitting
+    }
+    if(realtime_mode) {
+        set_up_realtime();          // Lock memory, command line interface moves to the I/O core
+    }
     set_up_buffer();                // Set up buffer (tx_buf)
+    set_up_modulation_tables();     // Set up byte to IQ lookup tables
+    set_up_crc_tables();            // Set up the CRC-32 lookup tables of the frames
+    set_up_fec_tables();            // Set up the convolutional encoder and Reed-Solomon tables
+    set_up_modulation_threads(modulation_threads);  // Start threads modulating slices of each packet
     print_seperator();              // Print a seperator to stdout
     sleep(SHORT_MESSAGE_DELAY);     // Delay between CLI messages
-    operate_transmitter();          // Transmitter operation via user input       
+    if(spool_dir != NULL) {
+        transmit_spool();           // Transmit the files of a spool directory without the menu
+    } else if(listen_spec != NULL) {
+        transmit_socket_input();    // Transmit the data received on a port without the menu
+    } else if(input_path != NULL) {
+        transmit_input_path();      // Transmit the command line input without the menu
+    } else {
+        operate_transmitter();      // Transmitter operation via user input
+    }
 
     // Clean up 
-    shutdown();
+    shut_down_transmitter();
 
     return 0; 
 }
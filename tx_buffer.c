@@ -0,0 +1,326 @@
+/* Transmit buffer backends for MARLIN SDR */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include "transmitter.h"
+
+// Backend state
+static enum tx_backend backend = TX_BACKEND_IIO;
+static struct iio_device *tx_dev = NULL;
+static struct iio_channel *tx_chn = NULL;
+static struct iio_buffer *tx_buf = NULL;
+static FILE *record_fp = NULL;
+
+// Kernel buffer queue configuration
+static unsigned int kernel_buffers = DEFAULT_KERNEL_BUFFERS;
+static size_t stream_buffer_samples = TEST_TRANSMIT_AMOUNT;
+static unsigned int prefill_buffers = DEFAULT_KERNEL_BUFFERS;
+
+// Current buffer
+static uint32_t *buffer_first = NULL;
+static size_t buffer_samples = 0;
+
+// Underflow statistics of the current transmission
+static bool underflow_checks = true;        // Cleared if the status register cannot be accessed
+static unsigned long long session_pushes = 0;
+static unsigned long long underflows = 0;
+static struct underflow_event underflow_log[UNDERFLOW_LOG_SIZE];
+static struct timespec session_start;
+
+// Push loop timing of the current transmission, measured once the kernel buffer queue is full
+static struct timespec last_push_return;
+static unsigned long long timed_pushes = 0;
+static double period_sum_us, period_min_us, period_max_us;     // From one push returning to the next
+static double loop_sum_us, loop_max_us;                         // From a push returning to the next push
+
+// Sets the number of kernel buffers queued for the DMA, the samples per buffer and the number of buffers
+// to have ready before the first push. Exits if the configuration does not fit the DMA limits.
+void set_tx_buffer_config(unsigned int num_kernel_buffers, size_t num_buffer_samples, unsigned int num_prefill_buffers) {
+    if(num_kernel_buffers < 1 || num_kernel_buffers > MAX_KERNEL_BUFFERS) {
+        printf("error: kernel buffer count must be between 1 and %d\n", MAX_KERNEL_BUFFERS);
+        exit(0);
+    }
+    if(num_buffer_samples < MIN_BUFFER_SAMPLES || num_buffer_samples > MAX_BUFFER_SAMPLES) {
+        printf("error: buffer samples must be between %d and %d\n", MIN_BUFFER_SAMPLES, MAX_BUFFER_SAMPLES);
+        exit(0);
+    }
+    if(num_buffer_samples % BUFFER_SAMPLES_MULTIPLE != 0) {
+        printf("error: buffer samples must be a multiple of %d\n", BUFFER_SAMPLES_MULTIPLE);
+        exit(0);
+    }
+    if((unsigned long long)num_kernel_buffers * num_buffer_samples * sizeof(uint32_t) > MAX_KERNEL_QUEUE_BYTES) {
+        printf("error: %u kernel buffers of %zu samples exceed the %d MB DMA memory limit\n",
+               num_kernel_buffers, num_buffer_samples, MAX_KERNEL_QUEUE_BYTES / (1024 * 1024));
+        exit(0);
+    }
+    if(num_prefill_buffers > PIPELINE_PACKETS) {
+        printf("error: prefill buffer count must be between 0 and %d\n", PIPELINE_PACKETS);
+        exit(0);
+    }
+    kernel_buffers = num_kernel_buffers;
+    stream_buffer_samples = num_buffer_samples;
+    prefill_buffers = num_prefill_buffers;
+}
+
+// Returns the number of kernel buffers queued for the DMA
+unsigned int get_kernel_buffers() {
+    return kernel_buffers;
+}
+
+// Returns the configured number of samples per streaming buffer
+size_t get_buffer_samples() {
+    return stream_buffer_samples;
+}
+
+// Returns the number of buffers to have modulated before the first push
+unsigned int get_prefill_buffers() {
+    return prefill_buffers;
+}
+
+// Selects the IIO backend. Buffers are created on the given device, whose first channel is chn.
+void set_up_tx_backend_iio(struct iio_device *dev, struct iio_channel *chn) {
+    backend = TX_BACKEND_IIO;
+    tx_dev = dev;
+    tx_chn = chn;
+}
+
+// Selects the record backend. Every pushed buffer is appended to the file at path, and a cyclic buffer
+// is written once, exactly as the DMA would replay it. Meant for checking transmitter output without hardware.
+void set_up_tx_backend_record(const char *path) {
+    printf("Setting up record backend (%s)\n", path);
+    backend = TX_BACKEND_RECORD;
+    record_fp = fopen(path, "wb");
+    null_error_check((void *)record_fp, "record file");
+}
+
+// Returns the selected backend
+enum tx_backend get_tx_backend() {
+    return backend;
+}
+
+// Creates the transmit buffer. A cyclic buffer is replayed by the DMA after its first push until destroyed.
+void create_tx_buffer(size_t num_samples, bool cyclic) {
+    if(backend == TX_BACKEND_IIO) {
+        // Must be set before the buffer is created. Pushes only block once all kernel buffers are queued.
+        less_than_zero_error_check(iio_device_set_kernel_buffers_count(tx_dev, kernel_buffers), "kernel buffers count");
+        tx_buf = iio_device_create_buffer(tx_dev, num_samples, cyclic);
+        null_error_check((void *)tx_buf, "tx_buf");
+
+        // The modulators write whole 32-bit IQ words, which requires i and q to be packed back to back
+        if(iio_buffer_step(tx_buf) != sizeof(uint32_t)) {
+            printf("error: tx_buf step is not one packed IQ sample\n");
+            exit(0);
+        }
+        buffer_first = (uint32_t *)iio_buffer_first(tx_buf, tx_chn);
+    } else {
+        buffer_first = malloc(num_samples * sizeof(uint32_t));
+        null_error_check((void *)buffer_first, "tx_buf");
+    }
+    buffer_samples = num_samples;
+}
+
+// Destroys the transmit buffer, which also stops a cyclic buffer from being replayed
+void destroy_tx_buffer() {
+    if(backend == TX_BACKEND_IIO) {
+        if(tx_buf) { iio_buffer_destroy(tx_buf); }
+        tx_buf = NULL;
+    } else {
+        free(buffer_first);
+    }
+    buffer_first = NULL;
+    buffer_samples = 0;
+}
+
+// Returns a pointer to the first packed IQ sample of the transmit buffer
+uint32_t *tx_buffer_first() {
+    return buffer_first;
+}
+
+// Returns a pointer just past the last sample of the transmit buffer
+uint32_t *tx_buffer_end() {
+    return buffer_first + buffer_samples;
+}
+
+// Returns the number of samples in the transmit buffer
+size_t tx_buffer_samples() {
+    return buffer_samples;
+}
+
+// Checks the DAC status after a push and clears it. The DAC idles in underflow until the first push
+// starts the DMA, so the status is only cleared after the first push of a transmission.
+static void check_underflow() {
+    struct timespec now;
+    uint32_t status;
+
+    if(!underflow_checks) {
+        return;
+    }
+    if(iio_device_reg_read(tx_dev, DAC_STATUS_REG, &status) < 0) {
+        printf("\nwarning: cannot read the DAC status, underflows are not detected\n");
+        underflow_checks = false;
+        return;
+    }
+    if(status & DAC_STATUS_UNDERFLOW) {
+        if(session_pushes > 1) {
+            if(underflows < UNDERFLOW_LOG_SIZE) {
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                underflow_log[underflows].push = session_pushes;
+                underflow_log[underflows].seconds = (now.tv_sec - session_start.tv_sec) +
+                                                    (now.tv_nsec - session_start.tv_nsec) / 1e9;
+            }
+            underflows++;
+        }
+        iio_device_reg_write(tx_dev, DAC_STATUS_REG, DAC_STATUS_UNDERFLOW);
+    }
+}
+
+// Returns the microseconds from start to end
+static double elapsed_us(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+// Adds a push to the push loop timing. Until the kernel buffer queue is full pushes return
+// right away, so only pushes after that follow the DMA and are timed.
+static void time_push(const struct timespec *push_call, const struct timespec *push_return) {
+    double period_us, loop_us;
+
+    if(session_pushes > kernel_buffers) {
+        period_us = elapsed_us(&last_push_return, push_return);
+        loop_us = elapsed_us(&last_push_return, push_call);
+        if(timed_pushes == 0 || period_us < period_min_us) { period_min_us = period_us; }
+        if(timed_pushes == 0 || period_us > period_max_us) { period_max_us = period_us; }
+        if(timed_pushes == 0 || loop_us > loop_max_us) { loop_max_us = loop_us; }
+        period_sum_us += period_us;
+        loop_sum_us += loop_us;
+        timed_pushes++;
+    }
+    last_push_return = *push_return;
+}
+
+// Pushes the transmit buffer. Returns the number of bytes pushed, or a negative error code.
+ssize_t push_tx_buffer() {
+    return push_tx_buffer_samples(buffer_samples);
+}
+
+// Pushes the first num_samples of the transmit buffer, fewer than the whole buffer for a short last packet.
+// Returns the number of bytes pushed or a negative error code, like push_tx_buffer.
+ssize_t push_tx_buffer_samples(size_t num_samples) {
+    struct timespec push_call, push_return;
+    ssize_t nbytes;
+
+    clock_gettime(CLOCK_MONOTONIC, &push_call);
+    if(backend == TX_BACKEND_IIO) {
+        nbytes = num_samples < buffer_samples ? iio_buffer_push_partial(tx_buf, num_samples) : iio_buffer_push(tx_buf);
+        // With the mmap interface a push hands the block to the DMA and dequeues the next one, so
+        // the samples of the next packet go to a different address
+        buffer_first = (uint32_t *)iio_buffer_first(tx_buf, tx_chn);
+    } else if(fwrite(buffer_first, sizeof(uint32_t), num_samples, record_fp) != num_samples) {
+        nbytes = -EIO;
+    } else {
+        nbytes = num_samples * sizeof(uint32_t);
+    }
+    if(nbytes < 0) {
+        return nbytes;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &push_return);
+
+    session_pushes++;
+    time_push(&push_call, &push_return);
+    if(backend == TX_BACKEND_IIO) {
+        check_underflow();
+    }
+    return nbytes;
+}
+
+// Prints why a push failed, nbytes being the negative error code it returned
+void print_push_error(ssize_t nbytes) {
+    printf("\nerror: could not push the transmit buffer (%s)\n", strerror(-(int)nbytes));
+}
+
+// Copies samples into the transmit buffer after the fill samples already in it, as many as fit.
+// Returns the number of samples copied.
+size_t fill_tx_buffer(size_t fill, const uint32_t *samples, size_t num_samples) {
+    if(num_samples > buffer_samples - fill) {
+        num_samples = buffer_samples - fill;
+    }
+    memcpy(buffer_first + fill, samples, num_samples * sizeof(uint32_t));
+    return num_samples;
+}
+
+// Pads a partly filled transmit buffer with zero samples up to a multiple of BUFFER_SAMPLES_MULTIPLE
+// for the DMA. Returns the number of samples to push.
+size_t pad_tx_buffer(size_t fill) {
+    size_t num_samples = (fill + BUFFER_SAMPLES_MULTIPLE - 1) / BUFFER_SAMPLES_MULTIPLE * BUFFER_SAMPLES_MULTIPLE;
+    memset(buffer_first + fill, 0, (num_samples - fill) * sizeof(uint32_t));
+    return num_samples;
+}
+
+// Sets whether pushes wait for a free kernel buffer. A non-blocking push returns -EAGAIN when the
+// kernel buffer queue is full. Returns 0, or a negative error code if the backend does not support it.
+int set_tx_buffer_blocking(bool blocking) {
+    if(backend == TX_BACKEND_IIO) {
+        return iio_buffer_set_blocking_mode(tx_buf, blocking);
+    }
+    return 0;
+}
+
+// Returns a file descriptor that polls writable (POLLOUT) when a push would not block,
+// or a negative error code if the backend does not support it
+int get_tx_buffer_poll_fd() {
+    if(backend == TX_BACKEND_IIO) {
+        return iio_buffer_get_poll_fd(tx_buf);
+    }
+    return fileno(record_fp);
+}
+
+// Starts counting underflows and timing pushes for a new transmission
+void reset_push_stats() {
+    session_pushes = 0;
+    underflows = 0;
+    timed_pushes = 0;
+    period_sum_us = 0;
+    loop_sum_us = 0;
+    clock_gettime(CLOCK_MONOTONIC, &session_start);
+}
+
+// Prints the push loop timing. A buffer is played out in the nominal period, so the period jitter shows how
+// far the push loop fell behind the DMA, and the time spent outside of the push shows how long the push thread
+// was busy or preempted before it could push again.
+static void print_push_jitter() {
+    if(timed_pushes == 0) {
+        return;
+    }
+    printf("Push loop: period %.0f us average (nominal %.0f us), %.0f to %.0f us, jitter %.0f us\n",
+           period_sum_us / timed_pushes, buffer_samples * 1e6 / SAMPLE_RATE,
+           period_min_us, period_max_us, period_max_us - period_min_us);
+    printf("Push loop: %.0f us average between pushes, %.0f us worst\n", loop_sum_us / timed_pushes, loop_max_us);
+}
+
+// Prints the push loop timing and the underflows counted since reset_push_stats
+void print_push_stats() {
+    print_push_jitter();
+    if(backend != TX_BACKEND_IIO || !underflow_checks) {
+        return;
+    }
+    if(underflows == 0) {
+        printf("No DAC underflows in %llu pushes\n", session_pushes);
+        return;
+    }
+    printf("DAC underflows: %llu in %llu pushes, the transmitted signal has gaps\n", underflows, session_pushes);
+    for(unsigned long long n = 0; n < underflows && n < UNDERFLOW_LOG_SIZE; n++) {
+        printf("- after push %llu, %.3f s into the transmission\n", underflow_log[n].push, underflow_log[n].seconds);
+    }
+    if(underflows > UNDERFLOW_LOG_SIZE) {
+        printf("- %llu more\n", underflows - UNDERFLOW_LOG_SIZE);
+    }
+}
+
+// Destroys the transmit buffer and closes the record file
+void shut_down_tx_backend() {
+    destroy_tx_buffer();
+    if(record_fp) {
+        fclose(record_fp);
+        record_fp = NULL;
+    }
+}
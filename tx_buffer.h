@@ -0,0 +1,61 @@
+#ifndef TX_BUFFER_H
+#define TX_BUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <iio.h>
+
+// Transmit buffer backends
+enum tx_backend {
+    TX_BACKEND_IIO,         // Buffers are pushed to the AD9361 Tx output driver
+    TX_BACKEND_RECORD       // Buffers are written to a file, no ADALM-PLUTO needed
+};
+
+// Kernel buffer queue limits. Every kernel buffer is a separate DMA transfer to the AD9361, so a buffer
+// is kept to whole 64-bit DMA bus beats and below the largest single transfer of the DMA controller, and
+// the whole queue has to fit in the contiguous memory the kernel can hand out on the ADALM-PLUTO.
+#define DEFAULT_KERNEL_BUFFERS 4                    // libiio default
+#define MAX_KERNEL_BUFFERS 64
+#define MIN_BUFFER_SAMPLES 1024                     // Leaves room for the default preamble and sync word of every modulation
+#define MAX_BUFFER_SAMPLES (4 * 1024 * 1024)        // 16 MB single DMA transfer
+#define BUFFER_SAMPLES_MULTIPLE 8
+#define MAX_KERNEL_QUEUE_BYTES (64 * 1024 * 1024)   // Kernel buffers * buffer samples * 4 bytes
+
+// DAC underflow detection. The AXI DAC core (cf-ad9361-dds-core-lpc) sets a sticky status bit whenever
+// the DMA did not deliver samples in time, which puts a gap in the transmitted signal.
+#define DAC_STATUS_REG 0x80000088       // Core status register, 0x80000000 selects the core register space
+#define DAC_STATUS_UNDERFLOW 0x1        // Write 1 to clear
+#define UNDERFLOW_LOG_SIZE 16           // Underflows logged with a timestamp, later ones are only counted
+
+// An underflow found after a push
+struct underflow_event {
+    unsigned long long push;        // Push after which the underflow bit was found set
+    double seconds;                 // Time since the transmission started
+};
+
+// Function prototypes
+void set_tx_buffer_config(unsigned int num_kernel_buffers, size_t num_buffer_samples, unsigned int num_prefill_buffers);
+unsigned int get_kernel_buffers();
+size_t get_buffer_samples();
+unsigned int get_prefill_buffers();
+void set_up_tx_backend_iio(struct iio_device *dev, struct iio_channel *chn);
+void set_up_tx_backend_record(const char *path);
+enum tx_backend get_tx_backend();
+void create_tx_buffer(size_t num_samples, bool cyclic);
+void destroy_tx_buffer();
+uint32_t *tx_buffer_first();
+uint32_t *tx_buffer_end();
+size_t tx_buffer_samples();
+ssize_t push_tx_buffer();
+ssize_t push_tx_buffer_samples(size_t num_samples);
+void print_push_error(ssize_t nbytes);
+size_t fill_tx_buffer(size_t fill, const uint32_t *samples, size_t num_samples);
+size_t pad_tx_buffer(size_t fill);
+int set_tx_buffer_blocking(bool blocking);
+int get_tx_buffer_poll_fd();
+void reset_push_stats();
+void print_push_stats();
+void shut_down_tx_backend();
+
+#endif /* TX_BUFFER_H */